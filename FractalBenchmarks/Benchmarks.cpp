@@ -0,0 +1,561 @@
+#include "pch.h"
+
+#include "Mandelbrot.h"
+#include "Formula.h"
+#include "DeepZoom.h"
+#include "Precision.h"
+#include "MandelbrotSimd.h"
+#include "MandelbrotGenerator.h"
+#include "ThreadPool.h"
+#include "Profiler.h"
+
+namespace {
+
+	using Clock = std::chrono::steady_clock;
+
+	double millisecondsSince(Clock::time_point start) {
+		return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+	}
+
+	// Every benchmark adds its results here. They are printed as they come and written
+	// as JSON at the end, so that runs on different commits can be diffed.
+	struct Result {
+		std::string benchmark;
+		std::vector<std::pair<std::string, std::string>> parameters;
+		std::vector<std::pair<std::string, double>> metrics;
+	};
+
+	std::vector<Result> results;
+
+	constexpr const char* simdNames[] = { "scalar", "avx2", "avx512" };
+	std::string filter; // Only benchmarks whose name contains this are run
+
+	bool selected(std::string_view benchmark) {
+		return benchmark.find(filter) != std::string_view::npos;
+	}
+
+	void report(Result result) {
+		std::cout << "[" << result.benchmark << "]";
+		for (const auto& [name, value] : result.parameters) {
+			std::cout << " " << name << ": " << value;
+		}
+		for (const auto& [name, value] : result.metrics) {
+			std::cout << " " << name << ": " << value;
+		}
+		std::cout << std::endl;
+		results.push_back(std::move(result));
+	}
+
+	std::string jsonString(std::string_view text) {
+		std::string quoted = "\"";
+		for (char c : text) {
+			if (c == '"' || c == '\\') {
+				quoted += '\\';
+			}
+			quoted += c;
+		}
+		return quoted + "\"";
+	}
+
+	std::string compilerName() {
+#if defined(_MSC_VER) && !defined(__clang__)
+		return "msvc " + std::to_string(_MSC_FULL_VER);
+#elif defined(__clang__)
+		return "clang " __clang_version__;
+#elif defined(__GNUC__)
+		return "gcc " __VERSION__;
+#else
+		return "unknown";
+#endif
+	}
+
+	bool writeResults(const std::string& path) {
+		std::ofstream file(path);
+		if (!file) {
+			return false;
+		}
+		file.precision(std::numeric_limits<double>::max_digits10);
+		file << "{\n  \"context\": {"
+			<< "\"compiler\": " << jsonString(compilerName())
+#ifdef NDEBUG
+			<< ", \"build\": \"release\""
+#else
+			<< ", \"build\": \"debug\""
+#endif
+			<< ", \"threads\": " << ThreadPool::shared().getThreadCount()
+			<< ", \"simd\": \"" << simdNames[static_cast<int>(mandelbrot::detectSimdLevel())] << "\"},\n"
+			<< "  \"benchmarks\": [";
+		for (size_t i = 0; i < results.size(); ++i) {
+			const auto& result = results[i];
+			file << (i ? ",\n" : "\n") << "    {\"benchmark\": " << jsonString(result.benchmark) << ", \"parameters\": {";
+			for (size_t j = 0; j < result.parameters.size(); ++j) {
+				file << (j ? ", " : "") << jsonString(result.parameters[j].first) << ": " << jsonString(result.parameters[j].second);
+			}
+			file << "}, \"metrics\": {";
+			for (size_t j = 0; j < result.metrics.size(); ++j) {
+				file << (j ? ", " : "") << jsonString(result.metrics[j].first) << ": " << result.metrics[j].second;
+			}
+			file << "}}";
+		}
+		file << "\n  ]\n}\n";
+		return static_cast<bool>(file);
+	}
+
+	// Runs 'function' until at least minimumSeconds have passed, at least once. Returns seconds per run.
+	template<typename Function>
+	double secondsPerRun(Function&& function, double minimumSeconds = 0.25) {
+		int runs = 0;
+		const auto start = Clock::now();
+		double elapsed;
+		do {
+			function();
+			++runs;
+			elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+		} while (elapsed < minimumSeconds);
+		return elapsed / runs;
+	}
+
+	// Fixed views, so that the numbers of different runs are comparable
+	struct Viewport {
+		const char* name;
+		double centerReal;
+		double centerImag;
+		double width;
+	};
+
+	constexpr Viewport fullView{ "full", -0.5, 0.0, 3.0 };
+	constexpr Viewport seahorseView{ "seahorse", -0.745, 0.11, 0.02 };
+
+	// Square grid of offsets covering [-radius, radius]^2
+	std::vector<std::complex<double>> makeGrid(int size, double radius, std::complex<double> shift = {}) {
+		std::vector<std::complex<double>> offsets;
+		offsets.reserve(size * size);
+		for (int y = 0; y < size; ++y) {
+			for (int x = 0; x < size; ++x) {
+				offsets.emplace_back((2.0 * x / (size - 1) - 1) * radius + shift.real(), (2.0 * y / (size - 1) - 1) * radius + shift.imag());
+			}
+		}
+		return offsets;
+	}
+
+	// Around the minibrot of period 8007 next to -0.743643887037158704752191506114774 + 0.131825904205311970493132056385139i,
+	// at about four times its size. The samples outside of it escape after 40000 iterations and more.
+	void benchmarkBla() {
+		constexpr const char* centerReal = "-0.74364388703715870475219150611477977821525620794818";
+		constexpr const char* centerImag = "0.13182590420531197049313205638514067897295227932891";
+		const double radius = 4e-32;
+		const int maxIter = 100000;
+		const int size = 100;
+		const double pixelSpacing = 2 * radius / (size - 1);
+		const double maxOffset = radius * std::sqrt(2.0);
+		const auto offsets = makeGrid(size, radius);
+
+		mandelbrot::withFixedPoint(mandelbrot::fixedPointLimbsForPixelSize(pixelSpacing), [&](auto zero) {
+			using Reference = decltype(zero);
+			mandelbrot::DeepZoom<Reference> deepZoom{ { *Reference::fromDecimal(centerReal), *Reference::fromDecimal(centerImag) }, maxIter };
+
+			std::vector<double> perturbed(offsets.size());
+			std::vector<double> approximated(offsets.size());
+
+			auto start = Clock::now();
+			deepZoom.calculateSmoothEscapeTime(offsets, perturbed);
+			const double perturbationTime = millisecondsSince(start);
+
+			// Samples that change by more than an iteration when moved by the tolerated error are noise at this
+			// pixel spacing, no evaluation in double reproduces them. The others must not change.
+			const double shift = mandelbrot::BlaTable::pixelTolerance * pixelSpacing;
+			std::vector<bool> resolved(offsets.size(), true);
+			for (std::complex<double> direction : { std::complex<double>{ 1, 0 }, std::complex<double>{ 0, 1 } }) {
+				const auto shifted = makeGrid(size, radius, shift * direction);
+				deepZoom.calculateSmoothEscapeTime(shifted, approximated);
+				for (size_t i = 0; i < offsets.size(); ++i) {
+					if (std::abs(perturbed[i] - approximated[i]) > 1) {
+						resolved[i] = false;
+					}
+				}
+			}
+			const auto unresolved = std::ranges::count(resolved, false);
+
+			const double derivedEpsilon = mandelbrot::BlaTable::epsilonForPixelSpacing(pixelSpacing, maxOffset, maxIter);
+			for (double epsilon : { derivedEpsilon, 0x1p-53, 0x1p-24 }) {
+				deepZoom.enableBlaWithEpsilon(maxOffset, epsilon);
+				deepZoom.resetBlaCounters();
+
+				start = Clock::now();
+				deepZoom.calculateSmoothEscapeTime(offsets, approximated);
+				const double blaTime = millisecondsSince(start);
+
+				int wrong = 0;
+				for (size_t i = 0; i < offsets.size(); ++i) {
+					if (resolved[i] && std::abs(perturbed[i] - approximated[i]) > 1) {
+						++wrong;
+					}
+				}
+
+				const auto& statistics = deepZoom.getBlaTable()->getStatistics();
+				const auto& counters = deepZoom.getBlaCounters();
+				std::ostringstream epsilonText;
+				epsilonText << epsilon;
+				report({ "bla", { { "epsilon", epsilonText.str() }, { "from pixel spacing", epsilon == derivedEpsilon ? "yes" : "no" } }, {
+					{ "perturbation ms", perturbationTime },
+					{ "bla ms", blaTime },
+					{ "speedup", perturbationTime / blaTime },
+					{ "wrong samples", static_cast<double>(wrong) },
+					{ "unresolved samples", static_cast<double>(unresolved) },
+					{ "table build ms", statistics.buildMilliseconds },
+					{ "levels", static_cast<double>(deepZoom.getBlaTable()->getLevelCount()) },
+					{ "entries", static_cast<double>(statistics.entries) },
+					{ "skips", static_cast<double>(counters.skips) },
+					{ "skipped iterations", static_cast<double>(counters.skippedIterations) },
+					{ "perturbation steps", static_cast<double>(counters.perturbationSteps) } } });
+			}
+		});
+	}
+
+	template<int Limbs>
+	void benchmarkFixedPointLimbs(const mandelbrot::HighPrecisionComplex<double>& c, int maxIter) {
+		using Number = numeric::FixedPoint<Limbs>;
+		constexpr int operations = 100000;
+
+		// Both loops converge, so the values stay in range
+		Number a(c.real);
+		const Number b(c.imag);
+		auto start = Clock::now();
+		for (int i = 0; i < operations; ++i) {
+			a = a * b + Number(c.real);
+		}
+		const double multiplyTime = millisecondsSince(start);
+
+		start = Clock::now();
+		for (int i = 0; i < operations; ++i) {
+			a = square(a) + Number(c.real);
+		}
+		const double squareTime = millisecondsSince(start);
+
+		start = Clock::now();
+		const mandelbrot::ReferenceOrbit<Number> orbit{ { Number(c.real), Number(c.imag) }, maxIter };
+		const double orbitTime = millisecondsSince(start);
+
+		report({ "fixed point", { { "limbs", std::to_string(Limbs) }, { "bits", std::to_string(Number::fractionBits) } }, {
+			{ "multiply ns", multiplyTime * 1e6 / operations },
+			{ "square ns", squareTime * 1e6 / operations },
+			{ "orbit iterations", static_cast<double>(orbit.getEscapeTime()) },
+			{ "orbit ms", orbitTime },
+			{ "result", static_cast<double>(a) } } });
+	}
+
+	void benchmarkFixedPoint() {
+		// Inside the period 3 bulb, so the orbit runs for all the iterations
+		const mandelbrot::HighPrecisionComplex<double> c{ -0.12, 0.74 };
+		const int maxIter = 1000000;
+		benchmarkFixedPointLimbs<2>(c, maxIter);
+		benchmarkFixedPointLimbs<4>(c, maxIter);
+		benchmarkFixedPointLimbs<8>(c, maxIter);
+		benchmarkFixedPointLimbs<16>(c, maxIter);
+		benchmarkFixedPointLimbs<32>(c, maxIter);
+	}
+
+	constexpr int escapeTimeGridSize = 64;
+	constexpr int escapeTimeMaxIters[] = { 100, 1000, 10000 };
+
+	// Written after every timed loop, so that the compiler can't drop the work
+	volatile double sink;
+
+	// Points of the grid as c, in NumericType
+	template<typename NumericType>
+	std::vector<std::pair<NumericType, NumericType>> makeViewGrid(const Viewport& view) {
+		std::vector<std::pair<NumericType, NumericType>> points;
+		for (const auto& offset : makeGrid(escapeTimeGridSize, view.width / 2)) {
+			points.emplace_back(NumericType(view.centerReal + offset.real()), NumericType(view.centerImag + offset.imag()));
+		}
+		return points;
+	}
+
+	// Only the iterations of the escaping points are counted. The interior ones are mostly recognized
+	// early by the cardioid and periodicity checks, so how much they cost isn't known.
+	struct EscapeCount {
+		uint64_t iterations = 0;
+		size_t interior = 0;
+
+		void add(int n, int maxIter) {
+			if (n < maxIter) {
+				iterations += n;
+			}
+			else {
+				++interior;
+			}
+		}
+	};
+
+	void reportEscapeTime(const char* benchmark, const char* type, const Viewport& view, int maxIter,
+		size_t samples, const EscapeCount& count, double seconds, const char* simd = nullptr) {
+		Result result{ benchmark, { { "type", type }, { "view", view.name }, { "maxIter", std::to_string(maxIter) } }, {
+			{ "samples/s", samples / seconds },
+			{ "iterations/s", count.iterations / seconds },
+			{ "interior fraction", static_cast<double>(count.interior) / samples } } };
+		if (simd) {
+			result.parameters.emplace_back("simd", simd);
+		}
+		report(std::move(result));
+	}
+
+	// calculateSmoothEscapeTime takes std::complex, so it is only measured with the built in types
+	template<typename NumericType>
+	void benchmarkEscapeTimeType(const char* type) {
+		constexpr bool smooth = std::is_floating_point_v<NumericType>;
+		if (!selected("escape time") && !(smooth && selected("smooth escape time"))) {
+			return;
+		}
+		for (const auto& view : { fullView, seahorseView }) {
+			const auto points = makeViewGrid<NumericType>(view);
+			for (int maxIter : escapeTimeMaxIters) {
+				EscapeCount count;
+				for (const auto& [real, imag] : points) {
+					count.add(mandelbrot::calculateEscapeTime(real, imag, maxIter).iterations, maxIter);
+				}
+				if (selected("escape time")) {
+					const double seconds = secondsPerRun([&] {
+						int total = 0;
+						for (const auto& [real, imag] : points) {
+							total += mandelbrot::calculateEscapeTime(real, imag, maxIter).iterations;
+						}
+						sink = total;
+					});
+					reportEscapeTime("escape time", type, view, maxIter, points.size(), count, seconds);
+				}
+				if constexpr (smooth) {
+					if (selected("smooth escape time")) {
+						const double seconds = secondsPerRun([&] {
+							double total = 0;
+							for (const auto& [real, imag] : points) {
+								total += mandelbrot::calculateSmoothEscapeTime(std::complex<NumericType>{ real, imag }, maxIter);
+							}
+							sink = total;
+						});
+						reportEscapeTime("smooth escape time", type, view, maxIter, points.size(), count, seconds);
+					}
+				}
+			}
+		}
+	}
+
+	void benchmarkEscapeTimeBatch() {
+		for (const auto& view : { fullView, seahorseView }) {
+			const auto points = makeViewGrid<float>(view);
+			std::vector<float> real, imag;
+			for (const auto& [r, i] : points) {
+				real.push_back(r);
+				imag.push_back(i);
+			}
+			std::vector<int> iterations(points.size());
+			std::vector<float> zReal(points.size());
+			std::vector<float> zImag(points.size());
+			for (int maxIter : escapeTimeMaxIters) {
+				// Every level the machine has, the scalar one is the baseline of the vector kernels
+				for (int level = 0; level <= static_cast<int>(mandelbrot::detectSimdLevel()); ++level) {
+					const auto simd = static_cast<mandelbrot::SimdLevel>(level);
+					mandelbrot::calculateEscapeTimeBatch(simd, real, imag, maxIter, iterations, zReal, zImag);
+					EscapeCount count;
+					for (int n : iterations) {
+						count.add(n, maxIter);
+					}
+					const double seconds = secondsPerRun([&] {
+						mandelbrot::calculateEscapeTimeBatch(simd, real, imag, maxIter, iterations, zReal, zImag);
+						sink = zReal[0];
+					});
+					reportEscapeTime("escape time batch", "float", view, maxIter, points.size(), count, seconds, simdNames[level]);
+				}
+			}
+		}
+	}
+
+	// The kernels of the dispatch table, the Mandelbrot one can be compared with "escape time" of double
+	void benchmarkFormulas() {
+		const auto points = makeViewGrid<double>(fullView);
+		std::vector<double> real, imag;
+		for (const auto& [r, i] : points) {
+			real.push_back(r);
+			imag.push_back(i);
+		}
+		std::vector<double> result(points.size());
+		const int maxIter = 1000;
+		for (const char* name : { "mandelbrot", "multibrot:3", "multibrot:8", "burning-ship:2", "tricorn:2", "julia:2" }) {
+			const auto kernel = mandelbrot::findFormulaKernel(*mandelbrot::parseFormula(name));
+			const std::complex<double> juliaConstant{ -0.8, 0.156 };
+			const double seconds = secondsPerRun([&] {
+				kernel(real, imag, juliaConstant, maxIter, result);
+				sink = result[0];
+			});
+			report({ "formula", { { "formula", name }, { "view", fullView.name }, { "maxIter", std::to_string(maxIter) } }, {
+				{ "samples/s", points.size() / seconds } } });
+		}
+	}
+
+	void benchmarkEscapeTime() {
+		benchmarkEscapeTimeType<float>("float");
+		benchmarkEscapeTimeType<double>("double");
+		benchmarkEscapeTimeType<numeric::DoubleDouble>("double double");
+		benchmarkEscapeTimeType<numeric::QuadDouble>("quad double");
+		if (selected("escape time batch")) {
+			benchmarkEscapeTimeBatch();
+		}
+		if (selected("formula")) {
+			benchmarkFormulas();
+		}
+	}
+
+	// Cheap stand in for the Mandelbrot set: rings around the origin, so that the
+	// mesh benchmarks measure the bookkeeping of the mesh rather than the fractal
+	struct RingGenerator {
+		void generate(std::span<const glm::vec2> positions, std::span<float> escapeTimes, double, int) const {
+			for (size_t i = 0; i < positions.size(); ++i) {
+				escapeTimes[i] = 40 * glm::length(positions[i]);
+			}
+		}
+	};
+
+	// The whole mesh, TriangleHandler starts with [-1, 1]^2
+	const geom::BBox2 meshView{ { -1, -1 }, { 1, 1 } };
+	constexpr size_t meshSizes[] = { 10000, 30000, 80000 };
+	constexpr int splitBatch = 500;
+	constexpr int measuredSplits = 5000;
+
+	void growMesh(TriangleHandler& mesh, size_t vertices) {
+		while (mesh.getPositions().size() < vertices) {
+			if (mesh.generateVertices(meshView, splitBatch) == 0) {
+				break;
+			}
+		}
+	}
+
+	// Times splitting the next measuredSplits triangles once the mesh has the given size
+	void benchmarkSplits(const char* benchmark, const VertexGenerator& generator, size_t vertices) {
+		TriangleHandler mesh{ generator };
+		growMesh(mesh, vertices);
+
+		const uint64_t iterationsBefore = profiler::get(profiler::Counter::Iterations);
+		int splits = 0;
+		const auto start = Clock::now();
+		while (splits < measuredSplits) {
+			const int divided = mesh.generateVertices(meshView, splitBatch);
+			if (divided == 0) {
+				break;
+			}
+			splits += divided;
+		}
+		const double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+		const uint64_t iterations = profiler::get(profiler::Counter::Iterations) - iterationsBefore;
+
+		Result result{ benchmark, { { "vertices", std::to_string(vertices) } }, {
+			{ "ns/split", seconds * 1e9 / std::max(splits, 1) },
+			{ "splits", static_cast<double>(splits) } } };
+		if (iterations > 0) {
+			result.metrics.emplace_back("iterations/s", iterations / seconds);
+		}
+		report(std::move(result));
+	}
+
+	// Times dropping everything outside the left half of the mesh
+	void benchmarkRemoveOutside(size_t vertices) {
+		TriangleHandler mesh{ RingGenerator{} };
+		growMesh(mesh, vertices);
+
+		const geom::BBox2 leftHalf{ { -1, -1 }, { 0, 1 } };
+		const auto start = Clock::now();
+		const int removed = mesh.removeTrianglesOutsideScreen(leftHalf, std::numeric_limits<int>::max());
+		const double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+		report({ "remove outside screen", { { "vertices", std::to_string(vertices) } }, {
+			{ "ns/triangle", seconds * 1e9 / std::max(removed, 1) },
+			{ "triangles", static_cast<double>(removed) } } });
+	}
+
+	// Saving a refined mesh and opening it again, against refining it from the start
+	void benchmarkSnapshot(size_t vertices) {
+		const std::string path = "benchmark_snapshot.mesh";
+
+		TriangleHandler mesh{ MandelbrotVertexGenerator{} };
+		auto start = Clock::now();
+		growMesh(mesh, vertices);
+		const double refine = millisecondsSince(start);
+
+		MeshSnapshotWriter writer;
+		start = Clock::now();
+		MeshSnapshotData data;
+		mesh.snapshot(meshView, data);
+		writer.save(path, std::move(data));
+		writer.flush();
+		const double save = millisecondsSince(start);
+
+		start = Clock::now();
+		TriangleHandler restored{ MandelbrotVertexGenerator{} };
+		const auto snapshot = MeshSnapshot::open(path);
+		const bool loaded = snapshot && restored.restore(*snapshot);
+		const double load = millisecondsSince(start);
+		std::filesystem::remove(path);
+		if (!loaded) {
+			std::cerr << "mesh snapshot: " << path << " could not be loaded" << std::endl;
+			return;
+		}
+
+		report({ "mesh snapshot", { { "vertices", std::to_string(vertices) } }, {
+			{ "refine ms", refine },
+			{ "save ms", save },
+			{ "load ms", load } } });
+	}
+
+	// divideTriangle is private, it is measured through generateVertices with a generator that costs next to nothing
+	void benchmarkTriangleHandler() {
+		for (size_t vertices : meshSizes) {
+			if (selected("divide triangle")) {
+				benchmarkSplits("divide triangle", RingGenerator{}, vertices);
+			}
+			if (selected("generate vertices")) {
+				// A cache of its own for every run, otherwise the later sizes would find their samples there
+				benchmarkSplits("generate vertices", MandelbrotVertexGenerator{}, vertices);
+			}
+			if (selected("distance estimate")) {
+				benchmarkSplits("distance estimate", MandelbrotVertexGenerator{ std::make_shared<SampleCache>(), true }, vertices);
+			}
+			if (selected("remove outside screen")) {
+				benchmarkRemoveOutside(vertices);
+			}
+			if (selected("mesh snapshot")) {
+				benchmarkSnapshot(vertices);
+			}
+		}
+	}
+}
+
+int main(int argc, char* argv[]) {
+	std::string output = "benchmarks.json";
+	for (int i = 1; i < argc; ++i) {
+		const std::string_view argument = argv[i];
+		if (argument == "--output" && i + 1 < argc) {
+			output = argv[++i];
+		}
+		else if (argument == "--filter" && i + 1 < argc) {
+			filter = argv[++i];
+		}
+		else {
+			std::cerr << "Usage: " << argv[0] << " [--output <file.json>] [--filter <benchmark name part>]" << std::endl;
+			return 1;
+		}
+	}
+
+	benchmarkEscapeTime();
+	benchmarkTriangleHandler();
+	if (selected("bla")) {
+		benchmarkBla();
+	}
+	if (selected("fixed point")) {
+		benchmarkFixedPoint();
+	}
+
+	if (!writeResults(output)) {
+		std::cerr << "Couldn't write " << output << std::endl;
+		return 1;
+	}
+	std::cout << results.size() << " results written to " << output << std::endl;
+	return 0;
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+// Allocator for containers whose data is read with aligned simd loads
+template<typename T, size_t Alignment>
+struct AlignedAllocator
+{
+	static_assert(Alignment >= alignof(T) && std::has_single_bit(Alignment));
+
+	using value_type = T;
+
+	template<typename U>
+	struct rebind {
+		using other = AlignedAllocator<U, Alignment>;
+	};
+
+	AlignedAllocator() = default;
+	template<typename U>
+	AlignedAllocator(const AlignedAllocator<U, Alignment>&) {}
+
+	T* allocate(size_t n) {
+		return static_cast<T*>(::operator new(n * sizeof(T), std::align_val_t{ Alignment }));
+	}
+
+	void deallocate(T* p, size_t) {
+		::operator delete(p, std::align_val_t{ Alignment });
+	}
+
+	template<typename U>
+	bool operator==(const AlignedAllocator<U, Alignment>&) const { return true; }
+};
+
+// Wide enough for an AVX register
+constexpr size_t simdAlignment = 32;
+
+template<typename T>
+using AlignedVector = std::vector<T, AlignedAllocator<T, simdAlignment>>;
@@ -0,0 +1,177 @@
+#pragma once
+
+#include "Perturbation.h"
+
+// Bilinear approximation (BLA) of the perturbed iteration.
+// As long as |d| is small compared to |Z|, d^2 can be dropped and l iterations collapse to
+//   d(m+l) = A*d(m) + B*dc
+// Level k of the table holds the steps of length 2^k starting at m = 1 + j*2^k, each with the
+// radius R under which the approximation error stays within epsilon.
+namespace mandelbrot {
+
+	struct BlaStep {
+		std::complex<double> a;
+		std::complex<double> b;
+		double radius2; // Squared validity radius
+	};
+
+	// Counters of a single calculateEscapeTimeBla call, summed by the caller if needed
+	struct BlaCounters {
+		uint64_t perturbationSteps = 0;
+		uint64_t skips = 0;
+		uint64_t skippedIterations = 0;
+
+		BlaCounters& operator+=(const BlaCounters& other) {
+			perturbationSteps += other.perturbationSteps;
+			skips += other.skips;
+			skippedIterations += other.skippedIterations;
+			return *this;
+		}
+	};
+
+	class BlaTable {
+	public:
+		struct Statistics {
+			double buildMilliseconds = 0;
+			size_t entries = 0;
+			std::vector<double> meanRadius; // Per level
+			std::vector<double> maxRadius; // Per level
+		};
+
+		// maxDc is the largest |dc| the table is used with, epsilon the allowed relative error of a step
+		BlaTable(const std::vector<std::complex<double>>& orbit, double maxDc, double epsilon) {
+			build(orbit, maxDc, epsilon);
+		}
+
+		// Fraction of the pixel spacing the approximation may move a sample by
+		static constexpr double pixelTolerance = 0x1p-8;
+
+		// Epsilon for samples pixelSpacing apart with |dc| up to maxDc. A relative error e of d moves the sample
+		// by about e*|dc|, and the errors of the skipped steps add up over at most maxIter iterations.
+		static double epsilonForPixelSpacing(double pixelSpacing, double maxDc, int maxIter) {
+			return pixelTolerance * pixelSpacing / (maxDc * std::max(maxIter, 1));
+		}
+
+		// Longest valid step starting at reference index m, no longer than maxLength.
+		// Returns the step and its length, or nullptr if not even a single step is valid.
+		std::pair<const BlaStep*, int> lookup(size_t m, double normD, int maxLength) const {
+			if (m == 0 || m_levels.empty() || m - 1 >= m_levels[0].size()) {
+				return { nullptr, 0 };
+			}
+			const size_t i = m - 1;
+
+			// Longer steps never have a larger radius than the single step from the same m
+			if (normD >= m_levels[0][i].radius2) {
+				return { nullptr, 0 };
+			}
+
+			// Only levels whose steps start at m
+			const int topLevel = i == 0 ? static_cast<int>(m_levels.size()) - 1
+				: std::min(std::countr_zero(i), static_cast<int>(m_levels.size()) - 1);
+			for (int level = topLevel; level > 0; --level) {
+				const size_t length = size_t{ 1 } << level;
+				const auto& steps = m_levels[level];
+				const size_t index = i >> level;
+				if (length <= static_cast<size_t>(maxLength) && index < steps.size() && normD < steps[index].radius2) {
+					return { &steps[index], static_cast<int>(length) };
+				}
+			}
+			return maxLength >= 1 ? std::pair{ &m_levels[0][i], 1 } : std::pair<const BlaStep*, int>{ nullptr, 0 };
+		}
+
+		int getLevelCount() const { return static_cast<int>(m_levels.size()); }
+		const Statistics& getStatistics() const { return m_statistics; }
+
+	private:
+		void build(const std::vector<std::complex<double>>& orbit, double maxDc, double epsilon) {
+			const auto startTime = std::chrono::steady_clock::now();
+
+			m_levels.clear();
+
+			// Level 0, one step from every Z(m) that has a successor. Z(0) is skipped, A would be 0.
+			std::vector<BlaStep> level;
+			for (size_t m = 1; m + 1 < orbit.size(); ++m) {
+				const std::complex<double> a = 2.0 * orbit[m];
+				const double radius = epsilon * std::abs(a);
+				level.push_back({ a, { 1.0, 0.0 }, radius * radius });
+			}
+
+			// Level k merges pairs of level k-1: first x, then y
+			while (!level.empty()) {
+				std::vector<BlaStep> next;
+				next.reserve(level.size() / 2);
+				for (size_t j = 0; j + 1 < level.size(); j += 2) {
+					const BlaStep& x = level[j];
+					const BlaStep& y = level[j + 1];
+					const double absAx = std::abs(x.a);
+					const double radiusY = (std::sqrt(y.radius2) - std::abs(x.b) * maxDc) / absAx;
+					const double radius = std::min(std::sqrt(x.radius2), std::max(0.0, radiusY));
+					next.push_back({ y.a * x.a, y.a * x.b + y.b, radius * radius });
+				}
+				m_levels.push_back(std::move(level));
+				level = std::move(next);
+			}
+
+			m_statistics = {};
+			for (const auto& steps : m_levels) {
+				double sum = 0;
+				double max = 0;
+				for (const auto& step : steps) {
+					const double radius = std::sqrt(step.radius2);
+					sum += radius;
+					max = std::max(max, radius);
+				}
+				m_statistics.entries += steps.size();
+				m_statistics.meanRadius.push_back(steps.empty() ? 0.0 : sum / steps.size());
+				m_statistics.maxRadius.push_back(max);
+			}
+			m_statistics.buildMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+		}
+
+		std::vector<std::vector<BlaStep>> m_levels;
+		Statistics m_statistics;
+	};
+
+	// Same as calculateEscapeTimePerturbed but jumps over iterations with the BLA table whenever possible
+	inline PerturbationResult calculateEscapeTimeBla(const std::vector<std::complex<double>>& orbit, const BlaTable& table,
+		std::complex<double> dc, int maxIter, BlaCounters* counters = nullptr) {
+		const size_t last = orbit.size() - 1;
+		size_t m = 1;
+		std::complex<double> d = dc;
+		int n = 0;
+		bool glitched = false;
+		BlaCounters local;
+		while (n < maxIter) {
+			const auto [step, length] = table.lookup(m, std::norm(d), maxIter - n);
+			if (step != nullptr) {
+				d = step->a * d + step->b * dc;
+				m += length;
+				n += length;
+				++local.skips;
+				local.skippedIterations += length;
+				continue;
+			}
+
+			const std::complex<double> z = orbit[m] + d;
+			const double normZ = std::norm(z);
+			if (normZ >= perturbation::bailout) {
+				break;
+			}
+			if (normZ < perturbation::glitchTolerance * perturbation::glitchTolerance * std::norm(orbit[m])) {
+				glitched = true;
+			}
+			if (normZ < std::norm(d) || m == last) {
+				d = z;
+				m = 0;
+			}
+			d = 2.0 * orbit[m] * d + d * d + dc;
+			++m;
+			++n;
+			++local.perturbationSteps;
+		}
+		if (counters) {
+			*counters += local;
+		}
+		return { n, orbit[m] + d, glitched };
+	}
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+using Color = glm::vec4;
+
+namespace coloring {
+
+	// Number of iterations one cycle of the palette covers
+	constexpr int paletteCycle = 500;
+
+	constexpr Color paletteColors[] = {
+		Color{0,0,0,1},
+		Color{0,0,1,1},
+		Color{0,1,1,1},
+		Color{1,0,0,1},
+		Color{1,1,0,1},
+		Color{1,1,1,1},
+	};
+
+	// Escape time difference that takes the palette from one color to the next
+	constexpr double paletteStep = static_cast<double>(paletteCycle) / std::size(paletteColors);
+
+	// Maps a smooth escape time to the palette
+	inline Color getColor(double value) {
+		constexpr int divider = paletteCycle;
+		const int floor = static_cast<int>(value);
+		double v = (floor % divider) + value - floor;
+		const auto& colors = paletteColors;
+		const auto size = std::size(colors);
+		const double slice = static_cast<double>(divider) / size;
+		for (int i = 0; i < size; ++i) {
+			double start = i * slice;
+			if (v <= start) {
+				Color c1 = colors[i];
+				Color c2 = i < size - 1 ? colors[i + 1] : colors[0];
+				float f = (start - v) / slice;
+				return glm::lerp(c2, c1, {f,f,f,f});
+			}
+		}
+		return { 0,0,0,0 };
+	}
+}
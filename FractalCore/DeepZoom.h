@@ -0,0 +1,115 @@
+#pragma once
+
+#include "Perturbation.h"
+#include "BilinearApproximation.h"
+
+namespace mandelbrot {
+
+	// Evaluates samples given as offsets from a high precision center.
+	// Glitched samples are recalculated using a new reference placed at one of them.
+	template<typename ReferenceType>
+	class DeepZoom {
+	public:
+		DeepZoom(HighPrecisionComplex<ReferenceType> center, int maxIter, int maxReferences = 8)
+			: m_center(center), m_maxIter(maxIter), m_maxReferences(maxReferences), m_reference(center, maxIter) {}
+
+		const HighPrecisionComplex<ReferenceType>& getCenter() const { return m_center; }
+		int getMaxIterations() const { return m_maxIter; }
+
+		// Number of references the last calculateSmoothEscapeTime call needed
+		int getReferencesUsed() const { return m_referencesUsed; }
+
+		// Skip iterations with bilinear approximation. maxOffset is the largest offset that will be evaluated,
+		// pixelSpacing the distance between neighbouring ones, see BlaTable::epsilonForPixelSpacing.
+		void enableBla(double maxOffset, double pixelSpacing) {
+			enableBlaWithEpsilon(maxOffset, BlaTable::epsilonForPixelSpacing(pixelSpacing, maxOffset, m_maxIter));
+		}
+
+		// Same with a fixed relative error per step
+		void enableBlaWithEpsilon(double maxOffset, double epsilon) {
+			m_blaMaxOffset = maxOffset;
+			m_blaEpsilon = epsilon;
+			m_blaTable.emplace(m_reference.getOrbit(), maxOffset, epsilon);
+		}
+
+		void disableBla() { m_blaTable.reset(); }
+
+		const std::optional<BlaTable>& getBlaTable() const { return m_blaTable; }
+
+		// Summed over all samples since the last reset
+		const BlaCounters& getBlaCounters() const { return m_blaCounters; }
+		void resetBlaCounters() { m_blaCounters = {}; }
+
+		PerturbationResult calculateEscapeTime(std::complex<double> offset) {
+			return calculateEscapeTime(m_reference.getOrbit(), m_blaTable ? &*m_blaTable : nullptr, offset, &m_blaCounters);
+		}
+
+		void calculateSmoothEscapeTime(std::span<const std::complex<double>> offsets, std::span<double> result) {
+			m_referencesUsed = calculateSmoothEscapeTime(offsets, result, &m_blaCounters);
+		}
+
+		// Same without touching the counters of this object, so it can be called from several threads at once.
+		// Returns the number of references needed, the BLA counters are added to counters if given.
+		int calculateSmoothEscapeTime(std::span<const std::complex<double>> offsets, std::span<double> result, BlaCounters* counters) const {
+			assert(offsets.size() == result.size());
+
+			const BlaTable* blaTable = m_blaTable ? &*m_blaTable : nullptr;
+			std::vector<size_t> glitched;
+			for (size_t i = 0; i < offsets.size(); ++i) {
+				const auto r = calculateEscapeTime(m_reference.getOrbit(), blaTable, offsets[i], counters);
+				result[i] = smoothIterationCount(r.iterations, std::abs(r.z), m_maxIter);
+				if (r.glitched) {
+					glitched.push_back(i);
+				}
+			}
+
+			int referencesUsed = 1;
+			while (!glitched.empty() && referencesUsed < m_maxReferences) {
+				// Rebase to a new reference at the first glitched sample
+				const std::complex<double> referenceOffset = offsets[glitched.front()];
+				const ReferenceOrbit<ReferenceType> reference{ {
+						m_center.real + ReferenceType(referenceOffset.real()),
+						m_center.imag + ReferenceType(referenceOffset.imag()) },
+					m_maxIter };
+				++referencesUsed;
+
+				// Offsets from the new reference can be up to twice as large, so the same error moves them twice as far
+				std::optional<BlaTable> table;
+				if (m_blaTable) {
+					table.emplace(reference.getOrbit(), 2 * m_blaMaxOffset, m_blaEpsilon / 2);
+				}
+
+				std::vector<size_t> stillGlitched;
+				for (size_t i : glitched) {
+					const auto r = calculateEscapeTime(reference.getOrbit(), table ? &*table : nullptr, offsets[i] - referenceOffset, counters);
+					result[i] = smoothIterationCount(r.iterations, std::abs(r.z), m_maxIter);
+					if (r.glitched) {
+						stillGlitched.push_back(i);
+					}
+				}
+				glitched = std::move(stillGlitched);
+			}
+			return referencesUsed;
+		}
+
+	private:
+		PerturbationResult calculateEscapeTime(const std::vector<std::complex<double>>& orbit, const BlaTable* table, std::complex<double> dc,
+			BlaCounters* counters) const {
+			if (table) {
+				return calculateEscapeTimeBla(orbit, *table, dc, m_maxIter, counters);
+			}
+			return calculateEscapeTimePerturbed(orbit, dc, m_maxIter);
+		}
+
+		HighPrecisionComplex<ReferenceType> m_center;
+		int m_maxIter;
+		int m_maxReferences;
+		int m_referencesUsed = 0;
+		ReferenceOrbit<ReferenceType> m_reference;
+
+		std::optional<BlaTable> m_blaTable;
+		double m_blaMaxOffset = 0;
+		double m_blaEpsilon = 0;
+		BlaCounters m_blaCounters;
+	};
+}
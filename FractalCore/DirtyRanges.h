@@ -0,0 +1,90 @@
+#pragma once
+
+// Set of element ranges [begin, end) that have changed. Ranges that are close to each other
+// are merged, so that copying them takes a few large copies instead of many small ones.
+class DirtyRanges
+{
+public:
+	struct Range {
+		size_t begin;
+		size_t end;
+	};
+
+	explicit DirtyRanges(size_t mergeGap = 64) : m_mergeGap(mergeGap) {}
+
+	bool empty() const { return m_ranges.empty(); }
+	void clear() { m_ranges.clear(); m_normalized = true; }
+
+	void add(size_t begin, size_t end) {
+		if (begin >= end) {
+			return;
+		}
+		// Writes in increasing order are common, they extend the last range directly
+		if (m_ranges.empty()) {
+			m_ranges.push_back({ begin, end });
+		}
+		else if (begin >= m_ranges.back().begin && begin <= m_ranges.back().end + m_mergeGap) {
+			m_ranges.back().end = std::max(m_ranges.back().end, end);
+		}
+		else {
+			m_normalized = m_normalized && begin > m_ranges.back().end;
+			m_ranges.push_back({ begin, end });
+		}
+		if (m_ranges.size() > maxUnnormalized) {
+			normalize();
+		}
+	}
+
+	void add(const DirtyRanges& other) {
+		for (const Range& range : other.m_ranges) {
+			add(range.begin, range.end);
+		}
+	}
+
+	// Drops everything past 'size'
+	void clip(size_t size) {
+		std::erase_if(m_ranges, [&](const Range& range) { return range.begin >= size; });
+		for (Range& range : m_ranges) {
+			range.end = std::min(range.end, size);
+		}
+	}
+
+	// Sorted, non overlapping ranges
+	const std::vector<Range>& getRanges() {
+		normalize();
+		return m_ranges;
+	}
+
+	size_t elementCount() {
+		size_t count = 0;
+		for (const Range& range : getRanges()) {
+			count += range.end - range.begin;
+		}
+		return count;
+	}
+
+private:
+	static constexpr size_t maxUnnormalized = 4096;
+
+	void normalize() {
+		if (m_normalized) {
+			return;
+		}
+		std::ranges::sort(m_ranges, {}, &Range::begin);
+		size_t last = 0;
+		for (size_t i = 1; i < m_ranges.size(); ++i) {
+			if (m_ranges[i].begin <= m_ranges[last].end + m_mergeGap) {
+				m_ranges[last].end = std::max(m_ranges[last].end, m_ranges[i].end);
+			}
+			else {
+				m_ranges[++last] = m_ranges[i];
+			}
+		}
+		m_ranges.resize(last + 1);
+		m_normalized = true;
+	}
+
+	size_t m_mergeGap;
+	std::vector<Range> m_ranges;
+	bool m_normalized = true;
+};
@@ -0,0 +1,121 @@
+#pragma once
+
+// Extended precision arithmetic on unevaluated sums of doubles, after Hida, Li & Bailey:
+// "Library for double-double and quad-double arithmetic". Everything is branch free except
+// the comparisons, so loops over arrays of these can be vectorized by the compiler.
+namespace numeric {
+
+	namespace detail {
+		// Error free transformations: the result plus the error is exactly the real result
+
+		// Requires |a| >= |b|
+		inline double quickTwoSum(double a, double b, double& error) {
+			const double s = a + b;
+			error = b - (s - a);
+			return s;
+		}
+
+		inline double twoSum(double a, double b, double& error) {
+			const double s = a + b;
+			const double bb = s - a;
+			error = (a - (s - bb)) + (b - bb);
+			return s;
+		}
+
+		inline double twoProd(double a, double b, double& error) {
+			const double p = a * b;
+			error = std::fma(a, b, -p);
+			return p;
+		}
+
+		inline double twoSquare(double a, double& error) {
+			const double p = a * a;
+			error = std::fma(a, a, -p);
+			return p;
+		}
+	}
+
+	// About 106 bits of mantissa, the exponent range of double
+	struct DoubleDouble {
+		double hi = 0.0;
+		double lo = 0.0;
+
+		constexpr DoubleDouble() = default;
+		constexpr DoubleDouble(double value) : hi(value) {}
+		constexpr DoubleDouble(double hi, double lo) : hi(hi), lo(lo) {}
+
+		explicit constexpr operator double() const { return hi; }
+
+		friend DoubleDouble operator+(const DoubleDouble& a, const DoubleDouble& b) {
+			double e, f;
+			double s = detail::twoSum(a.hi, b.hi, e);
+			const double t = detail::twoSum(a.lo, b.lo, f);
+			e += t;
+			s = detail::quickTwoSum(s, e, e);
+			e += f;
+			s = detail::quickTwoSum(s, e, e);
+			return { s, e };
+		}
+
+		friend constexpr DoubleDouble operator-(const DoubleDouble& a) {
+			return { -a.hi, -a.lo };
+		}
+
+		friend DoubleDouble operator-(const DoubleDouble& a, const DoubleDouble& b) {
+			return a + -b;
+		}
+
+		friend DoubleDouble operator*(const DoubleDouble& a, const DoubleDouble& b) {
+			double e;
+			double p = detail::twoProd(a.hi, b.hi, e);
+			e += a.hi * b.lo + a.lo * b.hi;
+			p = detail::quickTwoSum(p, e, e);
+			return { p, e };
+		}
+
+		friend DoubleDouble operator/(const DoubleDouble& a, const DoubleDouble& b) {
+			// Long division, one double of the quotient at a time
+			const double q1 = a.hi / b.hi;
+			DoubleDouble r = a - b * q1;
+			double q2 = r.hi / b.hi;
+			r = r - b * q2;
+			const double q3 = r.hi / b.hi;
+			const double q = detail::quickTwoSum(q1, q2, q2);
+			return DoubleDouble{ q, q2 } + q3;
+		}
+
+		DoubleDouble& operator+=(const DoubleDouble& other) { return *this = *this + other; }
+		DoubleDouble& operator-=(const DoubleDouble& other) { return *this = *this - other; }
+		DoubleDouble& operator*=(const DoubleDouble& other) { return *this = *this * other; }
+		DoubleDouble& operator/=(const DoubleDouble& other) { return *this = *this / other; }
+
+		friend constexpr bool operator==(const DoubleDouble& a, const DoubleDouble& b) {
+			return a.hi == b.hi && a.lo == b.lo;
+		}
+
+		friend constexpr std::partial_ordering operator<=>(const DoubleDouble& a, const DoubleDouble& b) {
+			return a.hi != b.hi ? a.hi <=> b.hi : a.lo <=> b.lo;
+		}
+	};
+
+	// Cheaper than a * a, the cross terms are the same
+	inline DoubleDouble square(const DoubleDouble& a) {
+		double e;
+		double p = detail::twoSquare(a.hi, e);
+		e += 2.0 * a.hi * a.lo;
+		p = detail::quickTwoSum(p, e, e);
+		return { p, e };
+	}
+
+	inline DoubleDouble abs(const DoubleDouble& a) {
+		return a.hi < 0.0 ? -a : a;
+	}
+}
+
+template<>
+class std::numeric_limits<numeric::DoubleDouble> : public std::numeric_limits<double> {
+public:
+	static constexpr int digits = 106;
+	static constexpr int digits10 = 31;
+	static constexpr numeric::DoubleDouble epsilon() { return 0x1p-104; }
+};
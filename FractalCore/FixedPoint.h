@@ -0,0 +1,331 @@
+#pragma once
+
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#endif
+
+// Arbitrary precision without external libraries, meant for reference orbits of very deep zooms
+namespace numeric {
+
+	namespace detail {
+		// 64x64 -> 128 bit product, the high half goes to 'high'
+		inline uint64_t multiplyWide(uint64_t a, uint64_t b, uint64_t& high) {
+#if defined(_MSC_VER) && !defined(__clang__)
+			return _umul128(a, b, &high);
+#else
+			const unsigned __int128 product = static_cast<unsigned __int128>(a) * b;
+			high = static_cast<uint64_t>(product >> 64);
+			return static_cast<uint64_t>(product);
+#endif
+		}
+
+		inline uint64_t addWithCarry(uint64_t a, uint64_t b, uint8_t& carry) {
+#if defined(_MSC_VER) && !defined(__clang__)
+			unsigned long long sum;
+			carry = _addcarry_u64(carry, a, b, &sum);
+			return sum;
+#else
+			const unsigned __int128 sum = static_cast<unsigned __int128>(a) + b + carry;
+			carry = static_cast<uint8_t>(sum >> 64);
+			return static_cast<uint64_t>(sum);
+#endif
+		}
+
+		inline uint64_t subtractWithBorrow(uint64_t a, uint64_t b, uint8_t& borrow) {
+#if defined(_MSC_VER) && !defined(__clang__)
+			unsigned long long difference;
+			borrow = _subborrow_u64(borrow, a, b, &difference);
+			return difference;
+#else
+			const unsigned __int128 difference = static_cast<unsigned __int128>(a) - b - borrow;
+			borrow = static_cast<uint8_t>((difference >> 64) != 0);
+			return static_cast<uint64_t>(difference);
+#endif
+		}
+
+		// Running sum of the 128 bit products of one column of a long multiplication
+		struct ColumnAccumulator {
+			uint64_t words[3] = {};
+
+			void add(uint64_t a, uint64_t b) {
+				uint64_t high;
+				const uint64_t low = multiplyWide(a, b, high);
+				uint8_t carry = 0;
+				words[0] = addWithCarry(words[0], low, carry);
+				words[1] = addWithCarry(words[1], high, carry);
+				words[2] += carry;
+			}
+
+			// Returns the finished column and moves the carry to the next one
+			uint64_t next() {
+				const uint64_t column = words[0];
+				words[0] = words[1];
+				words[1] = words[2];
+				words[2] = 0;
+				return column;
+			}
+		};
+	}
+
+	// Two's complement fixed point number of Limbs 64 bit limbs, least significant limb first.
+	// The top integerBits bits are left of the binary point, enough for everything the
+	// iteration produces before escaping. Products drop the columns below the result,
+	// which costs less than one unit in the last place.
+	template<int Limbs>
+	struct FixedPoint {
+		static_assert(Limbs >= 2);
+		static constexpr int integerBits = 8;
+		static constexpr int fractionBits = 64 * Limbs - integerBits;
+
+		std::array<uint64_t, Limbs> limbs{};
+
+		constexpr FixedPoint() = default;
+
+		// Exact, |value| must be below 2^(integerBits - 1)
+		FixedPoint(double value) {
+			int exponent;
+			const double mantissa = std::frexp(std::abs(value), &exponent);
+			if (mantissa == 0.0) {
+				return;
+			}
+			// value = m * 2^(exponent - 53) with an integer m
+			const uint64_t m = static_cast<uint64_t>(std::ldexp(mantissa, 53));
+			const int shift = exponent - 53 + fractionBits;
+			if (shift >= 0) {
+				const int limb = shift / 64;
+				const int bit = shift % 64;
+				if (limb < Limbs) {
+					limbs[limb] = m << bit;
+				}
+				if (bit != 0 && limb + 1 < Limbs) {
+					limbs[limb + 1] = m >> (64 - bit);
+				}
+			}
+			else if (shift > -64) {
+				limbs[0] = m >> -shift;
+			}
+			if (value < 0.0) {
+				*this = -*this;
+			}
+		}
+
+		// From another limb count, limbs missing at the bottom are zero and extra ones are cut off
+		template<int OtherLimbs>
+		explicit FixedPoint(const FixedPoint<OtherLimbs>& other) {
+			for (int i = 1; i <= std::min(Limbs, OtherLimbs); ++i) {
+				limbs[Limbs - i] = other.limbs[OtherLimbs - i];
+			}
+		}
+
+		explicit operator double() const {
+			const FixedPoint magnitude = abs(*this);
+			double result = 0.0;
+			for (int i = Limbs - 1; i >= std::max(0, Limbs - 3); --i) {
+				result += std::ldexp(static_cast<double>(magnitude.limbs[i]), 64 * i - fractionBits);
+			}
+			return isNegative() ? -result : result;
+		}
+
+		bool isNegative() const { return (limbs[Limbs - 1] >> 63) != 0; }
+
+		friend FixedPoint operator+(const FixedPoint& a, const FixedPoint& b) {
+			FixedPoint result;
+			uint8_t carry = 0;
+			for (int i = 0; i < Limbs; ++i) {
+				result.limbs[i] = detail::addWithCarry(a.limbs[i], b.limbs[i], carry);
+			}
+			return result;
+		}
+
+		friend FixedPoint operator-(const FixedPoint& a, const FixedPoint& b) {
+			FixedPoint result;
+			uint8_t borrow = 0;
+			for (int i = 0; i < Limbs; ++i) {
+				result.limbs[i] = detail::subtractWithBorrow(a.limbs[i], b.limbs[i], borrow);
+			}
+			return result;
+		}
+
+		friend FixedPoint operator-(const FixedPoint& a) {
+			return FixedPoint{} - a;
+		}
+
+		friend FixedPoint operator*(const FixedPoint& a, const FixedPoint& b) {
+			const FixedPoint x = abs(a);
+			const FixedPoint y = abs(b);
+			detail::ColumnAccumulator accumulator;
+			uint64_t product[Limbs + 1];
+			// One column below the result only for its carry
+			for (int column = Limbs - 2; column <= 2 * Limbs - 2; ++column) {
+				for (int i = std::max(0, column - (Limbs - 1)); i <= std::min(column, Limbs - 1); ++i) {
+					accumulator.add(x.limbs[i], y.limbs[column - i]);
+				}
+				const uint64_t value = accumulator.next();
+				if (column >= Limbs - 1) {
+					product[column - (Limbs - 1)] = value;
+				}
+			}
+			product[Limbs] = accumulator.next();
+			const FixedPoint result = fromProduct(product);
+			return a.isNegative() != b.isNegative() ? -result : result;
+		}
+
+		FixedPoint& operator+=(const FixedPoint& other) { return *this = *this + other; }
+		FixedPoint& operator-=(const FixedPoint& other) { return *this = *this - other; }
+		FixedPoint& operator*=(const FixedPoint& other) { return *this = *this * other; }
+
+		friend bool operator==(const FixedPoint& a, const FixedPoint& b) = default;
+
+		friend std::strong_ordering operator<=>(const FixedPoint& a, const FixedPoint& b) {
+			if (a.limbs[Limbs - 1] != b.limbs[Limbs - 1]) {
+				return static_cast<int64_t>(a.limbs[Limbs - 1]) <=> static_cast<int64_t>(b.limbs[Limbs - 1]);
+			}
+			for (int i = Limbs - 2; i >= 0; --i) {
+				if (a.limbs[i] != b.limbs[i]) {
+					return a.limbs[i] <=> b.limbs[i];
+				}
+			}
+			return std::strong_ordering::equal;
+		}
+
+		// Parses numbers like "-0.743643887037158704752191506114774" or "1.5e-3" with all the digits
+		// this precision can hold. The integer part must fit into integerBits.
+		static std::optional<FixedPoint> fromDecimal(std::string_view text) {
+			size_t i = 0;
+			bool negative = false;
+			if (i < text.size() && (text[i] == '-' || text[i] == '+')) {
+				negative = text[i++] == '-';
+			}
+
+			std::string digits;
+			int pointPosition = -1;
+			for (; i < text.size(); ++i) {
+				if (text[i] >= '0' && text[i] <= '9') {
+					digits.push_back(text[i]);
+				}
+				else if (text[i] == '.' && pointPosition < 0) {
+					pointPosition = static_cast<int>(digits.size());
+				}
+				else {
+					break;
+				}
+			}
+			if (digits.empty()) {
+				return std::nullopt;
+			}
+			// Number of digits before the point
+			int integerDigits = pointPosition < 0 ? static_cast<int>(digits.size()) : pointPosition;
+			if (i < text.size() && (text[i] == 'e' || text[i] == 'E')) {
+				++i;
+				if (i < text.size() && text[i] == '+') {
+					++i;
+				}
+				int exponent = 0;
+				const auto [end, error] = std::from_chars(text.data() + i, text.data() + text.size(), exponent);
+				if (error != std::errc{} || end == text.data() + i) {
+					return std::nullopt;
+				}
+				integerDigits += exponent;
+				i = end - text.data();
+			}
+			if (i != text.size()) {
+				return std::nullopt;
+			}
+
+			int64_t integerPart = 0;
+			for (int d = 0; d < std::min(integerDigits, static_cast<int>(digits.size())); ++d) {
+				integerPart = integerPart * 10 + (digits[d] - '0');
+				if (integerPart >= (int64_t(1) << (integerBits - 1))) {
+					return std::nullopt;
+				}
+			}
+			for (int d = static_cast<int>(digits.size()); d < integerDigits; ++d) {
+				integerPart *= 10;
+				if (integerPart >= (int64_t(1) << (integerBits - 1))) {
+					return std::nullopt;
+				}
+			}
+
+			// Fraction digits from the last one: f = (f + digit) / 10
+			FixedPoint fraction;
+			for (int d = static_cast<int>(digits.size()) - 1; d >= std::max(integerDigits, 0); --d) {
+				fraction = (fraction + FixedPoint(static_cast<double>(digits[d] - '0'))).divide(10);
+			}
+			for (int d = integerDigits; d < 0; ++d) {
+				fraction = fraction.divide(10);
+			}
+
+			const FixedPoint value = fraction + FixedPoint(static_cast<double>(integerPart));
+			return negative ? -value : value;
+		}
+
+	private:
+		template<int>
+		friend struct FixedPoint;
+
+		template<int L>
+		friend FixedPoint<L> square(const FixedPoint<L>& a);
+
+		// Product limbs Limbs - 1 ... 2 * Limbs - 1 to the fixed point result
+		static FixedPoint fromProduct(const uint64_t* product) {
+			constexpr int shift = 64 - integerBits;
+			FixedPoint result;
+			for (int i = 0; i < Limbs; ++i) {
+				result.limbs[i] = (product[i] >> shift) | (product[i + 1] << integerBits);
+			}
+			return result;
+		}
+
+		// Non negative values only
+		FixedPoint divide(uint32_t divisor) const {
+			FixedPoint result;
+			uint64_t remainder = 0;
+			for (int i = Limbs - 1; i >= 0; --i) {
+				// In halves so that everything fits into 64 bits
+				const uint64_t high = (remainder << 32) | (limbs[i] >> 32);
+				remainder = high % divisor;
+				const uint64_t low = (remainder << 32) | (limbs[i] & 0xffffffffu);
+				remainder = low % divisor;
+				result.limbs[i] = ((high / divisor) << 32) | (low / divisor);
+			}
+			return result;
+		}
+	};
+
+	template<int Limbs>
+	FixedPoint<Limbs> abs(const FixedPoint<Limbs>& a) {
+		return a.isNegative() ? -a : a;
+	}
+
+	// Each product below the diagonal is calculated once and added twice, about half the multiplications of a * a
+	template<int Limbs>
+	FixedPoint<Limbs> square(const FixedPoint<Limbs>& a) {
+		const FixedPoint<Limbs> x = abs(a);
+		detail::ColumnAccumulator accumulator;
+		uint64_t product[Limbs + 1];
+		for (int column = Limbs - 2; column <= 2 * Limbs - 2; ++column) {
+			const int first = std::max(0, column - (Limbs - 1));
+			for (int i = first; i < column - i; ++i) {
+				accumulator.add(x.limbs[i], x.limbs[column - i]);
+				accumulator.add(x.limbs[i], x.limbs[column - i]);
+			}
+			if (column % 2 == 0) {
+				accumulator.add(x.limbs[column / 2], x.limbs[column / 2]);
+			}
+			const uint64_t value = accumulator.next();
+			if (column >= Limbs - 1) {
+				product[column - (Limbs - 1)] = value;
+			}
+		}
+		product[Limbs] = accumulator.next();
+		return FixedPoint<Limbs>::fromProduct(product);
+	}
+
+	// 2 * a * b from the squares of a and b. Squaring is about half the work of multiplying
+	// and without rounding the difference loses nothing.
+	template<int Limbs>
+	FixedPoint<Limbs> twiceProduct(const FixedPoint<Limbs>& a, const FixedPoint<Limbs>& b,
+		const FixedPoint<Limbs>& aSquared, const FixedPoint<Limbs>& bSquared) {
+		return square(a + b) - aSquared - bSquared;
+	}
+}
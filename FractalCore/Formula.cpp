@@ -0,0 +1,77 @@
+#include "pch.h"
+
+#include "Formula.h"
+#include "Mandelbrot.h"
+
+namespace {
+	using namespace mandelbrot;
+
+	constexpr std::string_view familyNames[] = { "multibrot", "burning-ship", "tricorn", "julia" };
+	constexpr int exponentCount = maxExponent - minExponent + 1;
+
+	template<typename F>
+	void smoothEscapeTimes(std::span<const double> real, std::span<const double> imag,
+		std::complex<double> juliaConstant, int maxIter, std::span<double> result)
+	{
+		for (size_t i = 0; i < real.size(); ++i) {
+			const auto escape = calculateFormulaEscapeTime<F>(real[i], imag[i], maxIter, juliaConstant);
+			result[i] = smoothIterationCount(escape.iterations, std::abs(escape.z), maxIter, F::exponent);
+		}
+	}
+
+	// Every family and exponent, in the order of tableIndex
+	template<size_t... Indices>
+	constexpr std::array<FormulaKernel, sizeof...(Indices)> makeKernelTable(std::index_sequence<Indices...>)
+	{
+		return { &smoothEscapeTimes<Formula<static_cast<Family>(Indices / exponentCount), minExponent + Indices % exponentCount>>... };
+	}
+
+	constexpr auto kernelTable = makeKernelTable(std::make_index_sequence<static_cast<size_t>(Family::Count) * exponentCount>{});
+
+	constexpr size_t tableIndex(const FormulaId& formula)
+	{
+		return static_cast<size_t>(formula.family) * exponentCount + (formula.exponent - minExponent);
+	}
+}
+
+std::optional<mandelbrot::FormulaId> mandelbrot::parseFormula(std::string_view text)
+{
+	if (text == "mandelbrot") {
+		return FormulaId{};
+	}
+
+	FormulaId formula;
+	const size_t separator = text.find(':');
+	if (separator != std::string_view::npos) {
+		const std::string_view exponent = text.substr(separator + 1);
+		const auto [end, error] = std::from_chars(exponent.data(), exponent.data() + exponent.size(), formula.exponent);
+		if (error != std::errc{} || end != exponent.data() + exponent.size()
+			|| formula.exponent < minExponent || formula.exponent > maxExponent) {
+			return std::nullopt;
+		}
+		text = text.substr(0, separator);
+	}
+
+	const auto family = std::ranges::find(familyNames, text);
+	if (family == std::end(familyNames)) {
+		return std::nullopt;
+	}
+	formula.family = static_cast<Family>(family - std::begin(familyNames));
+	return formula;
+}
+
+std::string mandelbrot::formulaName(const FormulaId& formula)
+{
+	if (formula.isMandelbrot()) {
+		return "mandelbrot";
+	}
+	return std::string(familyNames[static_cast<size_t>(formula.family)]) + ":" + std::to_string(formula.exponent);
+}
+
+mandelbrot::FormulaKernel mandelbrot::findFormulaKernel(const FormulaId& formula)
+{
+	if (formula.family >= Family::Count || formula.exponent < minExponent || formula.exponent > maxExponent) {
+		return nullptr;
+	}
+	return kernelTable[tableIndex(formula)];
+}
@@ -0,0 +1,109 @@
+#pragma once
+
+namespace mandelbrot {
+
+	// Extended precision types provide a faster overload of this
+	template<typename NumericType>
+	constexpr NumericType square(NumericType x) {
+		return x * x;
+	}
+
+	enum class Family {
+		Multibrot, // z^n + c
+		BurningShip, // (|Re z| + i|Im z|)^n + c
+		Tricorn, // conj(z)^n + c
+		Julia, // z^n + k with a fixed k, the point is the start of the orbit
+		Count
+	};
+
+	// One iteration formula as compile time parameters, every combination gets a kernel of its own
+	template<Family F, int Exponent>
+	struct Formula {
+		static_assert(Exponent >= 2);
+		static constexpr Family family = F;
+		static constexpr int exponent = Exponent;
+	};
+
+	using Mandelbrot = Formula<Family::Multibrot, 2>;
+
+	// Exponents the runtime dispatch has kernels for
+	constexpr int minExponent = 2;
+	constexpr int maxExponent = 8;
+
+	template<typename NumericType>
+	struct ComplexPair {
+		NumericType real;
+		NumericType imag;
+	};
+
+	template<typename NumericType>
+	constexpr ComplexPair<NumericType> multiply(const ComplexPair<NumericType>& a, const ComplexPair<NumericType>& b) {
+		return { a.real * b.real - a.imag * b.imag, a.real * b.imag + a.imag * b.real };
+	}
+
+	template<typename NumericType>
+	constexpr ComplexPair<NumericType> squareOf(const ComplexPair<NumericType>& a) {
+		const NumericType realImag = a.real * a.imag;
+		return { square(a.real) - square(a.imag), realImag + realImag };
+	}
+
+	// z^Exponent by squaring, unrolled at compile time. z2 is z^2, which the iteration gets
+	// almost for free from the squares it needs for the bailout test anyway.
+	template<int Exponent, typename NumericType>
+	constexpr ComplexPair<NumericType> power(const ComplexPair<NumericType>& z, const ComplexPair<NumericType>& z2) {
+		if constexpr (Exponent == 1) {
+			return z;
+		}
+		else if constexpr (Exponent == 2) {
+			return z2;
+		}
+		else if constexpr (Exponent % 2 == 0) {
+			return squareOf(power<Exponent / 2>(z, z2));
+		}
+		else {
+			return multiply(power<Exponent - 1>(z, z2), z);
+		}
+	}
+
+	// One step of the formula. zr2 and zi2 are the squares of zr and zi, before and after.
+	template<typename F, typename NumericType>
+	constexpr void iterateFormula(NumericType& zr, NumericType& zi, NumericType& zr2, NumericType& zi2,
+		const NumericType& cr, const NumericType& ci) {
+		using std::abs;
+		ComplexPair<NumericType> z{ zr, zi };
+		if constexpr (F::family == Family::BurningShip) {
+			z = { abs(zr), abs(zi) };
+		}
+		else if constexpr (F::family == Family::Tricorn) {
+			z.imag = -zi;
+		}
+		const NumericType realImag = z.real * z.imag;
+		const auto next = power<F::exponent>(z, ComplexPair<NumericType>{ zr2 - zi2, realImag + realImag });
+		zr = next.real + cr;
+		zi = next.imag + ci;
+		zr2 = square(zr);
+		zi2 = square(zi);
+	}
+
+	// Formula chosen at runtime
+	struct FormulaId {
+		Family family = Family::Multibrot;
+		int exponent = 2;
+
+		bool operator==(const FormulaId&) const = default;
+		bool isMandelbrot() const { return family == Family::Multibrot && exponent == 2; }
+	};
+
+	// "mandelbrot", or one of "multibrot", "burning-ship", "tricorn" and "julia" optionally
+	// followed by ":<exponent>", for example "multibrot:3"
+	std::optional<FormulaId> parseFormula(std::string_view text);
+	std::string formulaName(const FormulaId& formula);
+
+	// Smooth escape times of the points (real[i], imag[i]), calculated in double precision.
+	// juliaConstant is the fixed k of the Julia family, ignored by the others.
+	using FormulaKernel = void(*)(std::span<const double> real, std::span<const double> imag,
+		std::complex<double> juliaConstant, int maxIter, std::span<double> result);
+
+	// Kernel of the formula from the dispatch table, nullptr if the exponent is out of range
+	FormulaKernel findFormulaKernel(const FormulaId& formula);
+}
@@ -0,0 +1,36 @@
+#include "pch.h"
+
+#include "FractalCore.h"
+
+namespace {
+	constexpr int divisionsPerRound = 400;
+}
+
+RefinedMesh refineMesh(const geom::BBox2& view, size_t maxVertices, const VertexGenerator& generator)
+{
+	TriangleHandler triangleHandler{ generator };
+	maxVertices = std::min(maxVertices, constants::targetVertices);
+	while (triangleHandler.getVertexCount() < maxVertices) {
+		const int amount = static_cast<int>(std::min<size_t>(divisionsPerRound, maxVertices - triangleHandler.getVertexCount()));
+		if (triangleHandler.generateVertices(view, amount) == 0) {
+			break;
+		}
+		triangleHandler.removeTrianglesOutsideScreen(view, std::numeric_limits<int>::max());
+	}
+
+	// Vertices are numbered again in the order the triangles first use them
+	const auto& positions = triangleHandler.getPositions();
+	const auto& escapeTimes = triangleHandler.getEscapeTimes();
+	std::vector<uint32_t> newIndex(positions.size(), std::numeric_limits<uint32_t>::max());
+	RefinedMesh mesh;
+	mesh.indices.reserve(triangleHandler.getIndeices().size());
+	for (uint32_t vertex : triangleHandler.getIndeices()) {
+		if (newIndex[vertex] == std::numeric_limits<uint32_t>::max()) {
+			newIndex[vertex] = static_cast<uint32_t>(mesh.positions.size());
+			mesh.positions.push_back(positions[vertex]);
+			mesh.escapeTimes.push_back(escapeTimes[vertex]);
+		}
+		mesh.indices.push_back(newIndex[vertex]);
+	}
+	return mesh;
+}
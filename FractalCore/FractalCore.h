@@ -0,0 +1,20 @@
+#pragma once
+
+// Entry points for using the core without a window or a gpu: rendering an image
+// or refining a mesh for a view. Everything the core has is usable from here.
+
+#include "TileRenderer.h"
+#include "MandelbrotGenerator.h"
+
+// Mesh of a view with only the vertices its triangles use. Vertex i is at positions[i]
+// with the smooth escape time escapeTimes[i], every three indices make a triangle.
+struct RefinedMesh {
+	std::vector<glm::vec2> positions;
+	std::vector<float> escapeTimes;
+	std::vector<uint32_t> indices;
+};
+
+// Refines the mesh of [-1, 1]^2 for the view until it has maxVertices vertices or no triangle
+// is worth dividing anymore. Triangles outside the view are left out.
+RefinedMesh refineMesh(const geom::BBox2& view, size_t maxVertices = constants::targetVertices,
+	const VertexGenerator& generator = MandelbrotVertexGenerator{});
@@ -0,0 +1,83 @@
+#include "pch.h"
+
+#include "HistogramColoring.h"
+#include "ThreadPool.h"
+
+namespace {
+	constexpr size_t trianglesPerChunk = 8192;
+
+	// Part of the way the distribution moves towards a new histogram
+	constexpr double adaptRate = 0.3;
+
+	// From the first palette color to the last one, without wrapping back to the first
+	constexpr double paletteSpan = coloring::paletteStep * (std::size(coloring::paletteColors) - 1);
+}
+
+void HistogramColoring::collect(std::span<const glm::vec2> positions, std::span<const float> escapeTimes, std::span<const uint32_t> indices,
+	const geom::BBox2& view, int maxIterations, std::vector<double>& bins)
+{
+	const size_t triangles = indices.size() / 3;
+	const size_t chunks = std::max<size_t>((triangles + trianglesPerChunk - 1) / trianglesPerChunk, 1);
+	const double binsPerIteration = static_cast<double>(binCount) / maxIterations;
+
+	// Every chunk has its own histogram, they are summed afterwards
+	std::vector<double> partial(chunks * binCount, 0.0);
+	ThreadPool::shared().parallelFor(triangles, trianglesPerChunk, [&](size_t begin, size_t end) {
+		double* histogram = partial.data() + begin / trianglesPerChunk * binCount;
+		for (size_t triangle = begin; triangle < end; ++triangle) {
+			const uint32_t* vertices = &indices[triangle * 3];
+			const glm::vec2 p0 = positions[vertices[0]];
+			const glm::vec2 p1 = positions[vertices[1]];
+			const glm::vec2 p2 = positions[vertices[2]];
+			if (!view.collidesWith({ p0, p1, p2 })) {
+				continue;
+			}
+
+			const double third = std::abs(static_cast<double>(p1.x - p0.x) * (p2.y - p0.y) - static_cast<double>(p2.x - p0.x) * (p1.y - p0.y)) / 6;
+			for (int i = 0; i < 3; ++i) {
+				const float escapeTime = escapeTimes[vertices[i]];
+				if (escapeTime < maxIterations) {
+					const size_t bin = static_cast<size_t>(std::max(escapeTime * binsPerIteration, 0.0));
+					histogram[std::min(bin, binCount - 1)] += third;
+				}
+			}
+		}
+	});
+
+	bins.assign(binCount, 0.0);
+	for (size_t chunk = 0; chunk < chunks; ++chunk) {
+		for (size_t bin = 0; bin < binCount; ++bin) {
+			bins[bin] += partial[chunk * binCount + bin];
+		}
+	}
+}
+
+void HistogramColoring::update(std::span<const double> bins)
+{
+	assert(bins.size() == binCount);
+	double total = 0;
+	for (double area : bins) {
+		total += area;
+	}
+	if (total <= 0) {
+		return;
+	}
+
+	const double rate = m_hasCdf ? adaptRate : 1.0;
+	double sum = 0;
+	for (size_t i = 0; i <= binCount; ++i) {
+		m_cdf[i] += (sum / total - m_cdf[i]) * rate;
+		if (i < binCount) {
+			sum += bins[i];
+		}
+	}
+	m_hasCdf = true;
+}
+
+Color HistogramColoring::getColor(double escapeTime) const
+{
+	const double position = std::clamp(escapeTime / m_maxIterations * binCount, 0.0, static_cast<double>(binCount));
+	const size_t bin = std::min(static_cast<size_t>(position), binCount - 1);
+	const double cdf = glm::mix(m_cdf[bin], m_cdf[bin + 1], position - bin);
+	return coloring::getColor(cdf * paletteSpan);
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include "utils.h"
+#include "Coloring.h"
+
+// Histogram equalized coloring. The palette is spread over the distribution of escape times in the
+// view instead of repeating every coloring::paletteCycle iterations, so every color covers about the
+// same area of the screen however deep the view is.
+class HistogramColoring
+{
+public:
+	static constexpr size_t binCount = 1024;
+
+	explicit HistogramColoring(int maxIterations) : m_maxIterations(maxIterations), m_cdf(binCount + 1) {}
+
+	// Screen area of the mesh by escape time, each vertex takes a third of the area of each of its
+	// triangles that touches the view. Points inside the set are left out. Runs on the shared thread pool.
+	static void collect(std::span<const glm::vec2> positions, std::span<const float> escapeTimes, std::span<const uint32_t> indices,
+		const geom::BBox2& view, int maxIterations, std::vector<double>& bins);
+
+	// Moves the distribution towards the histogram, a part at a time so that the colors don't flicker
+	void update(std::span<const double> bins);
+
+	// Escape times of [0, getRange()) map to the whole palette
+	Color getColor(double escapeTime) const;
+	double getRange() const { return m_maxIterations; }
+
+private:
+	int m_maxIterations;
+	std::vector<double> m_cdf; // Value at the start of every bin and at the end
+	bool m_hasCdf = false;
+};
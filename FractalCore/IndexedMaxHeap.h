@@ -0,0 +1,156 @@
+#pragma once
+
+// Binary max heap of ids with a key each. Keeps track of the position of every id,
+// so that the key of any id can be changed or the id removed in O(log N).
+class IndexedMaxHeap
+{
+public:
+	struct Entry {
+		double key;
+		uint32_t id;
+	};
+
+	bool empty() const { return m_heap.empty(); }
+	size_t size() const { return m_heap.size(); }
+	const Entry& top() const { return m_heap.front(); }
+
+	bool contains(uint32_t id) const {
+		return id < m_positions.size() && m_positions[id] != notInHeap;
+	}
+
+	double getKey(uint32_t id) const {
+		assert(contains(id));
+		return m_heap[m_positions[id]].key;
+	}
+
+	void clear() {
+		m_heap.clear();
+		m_positions.clear();
+	}
+
+	// Entries in heap order, the top first
+	std::span<const Entry> getEntries() const { return m_heap; }
+
+	// Replaces the contents in O(N), the entries can be in any order. Ids must be unique.
+	void assign(std::span<const Entry> entries) {
+		clear();
+		m_heap.assign(entries.begin(), entries.end());
+		for (size_t position = 0; position < m_heap.size(); ++position) {
+			const uint32_t id = m_heap[position].id;
+			if (id >= m_positions.size()) {
+				m_positions.resize(id + 1, notInHeap);
+			}
+			assert(m_positions[id] == notInHeap);
+			m_positions[id] = static_cast<uint32_t>(position);
+		}
+		for (size_t position = m_heap.size() / 2; position-- > 0;) {
+			siftDown(position);
+		}
+	}
+
+	void reserve(size_t size) {
+		m_heap.reserve(size);
+		m_positions.reserve(size);
+	}
+
+	void push(uint32_t id, double key) {
+		assert(!contains(id));
+		if (id >= m_positions.size()) {
+			m_positions.resize(id + 1, notInHeap);
+		}
+		m_heap.push_back({ key, id });
+		m_positions[id] = static_cast<uint32_t>(m_heap.size() - 1);
+		siftUp(m_heap.size() - 1);
+	}
+
+	// Pushes the id if it isn't in the heap yet
+	void update(uint32_t id, double key) {
+		if (!contains(id)) {
+			push(id, key);
+			return;
+		}
+		const size_t position = m_positions[id];
+		const double oldKey = m_heap[position].key;
+		m_heap[position].key = key;
+		if (key > oldKey) {
+			siftUp(position);
+		}
+		else {
+			siftDown(position);
+		}
+	}
+
+	void erase(uint32_t id) {
+		assert(contains(id));
+		const size_t position = m_positions[id];
+		m_positions[id] = notInHeap;
+		const size_t last = m_heap.size() - 1;
+		if (position != last) {
+			m_heap[position] = m_heap[last];
+			m_positions[m_heap[position].id] = static_cast<uint32_t>(position);
+			m_heap.pop_back();
+			if (position > 0 && m_heap[position].key > m_heap[parent(position)].key) {
+				siftUp(position);
+			}
+			else {
+				siftDown(position);
+			}
+		}
+		else {
+			m_heap.pop_back();
+		}
+	}
+
+	// The id 'from' is known as 'to' from now on. Used when the owner moves its elements around.
+	void rename(uint32_t from, uint32_t to) {
+		assert(contains(from) && !contains(to));
+		if (to >= m_positions.size()) {
+			m_positions.resize(to + 1, notInHeap);
+		}
+		const uint32_t position = m_positions[from];
+		m_positions[from] = notInHeap;
+		m_positions[to] = position;
+		m_heap[position].id = to;
+	}
+
+private:
+	static constexpr uint32_t notInHeap = std::numeric_limits<uint32_t>::max();
+
+	static size_t parent(size_t position) { return (position - 1) / 2; }
+
+	void swapEntries(size_t a, size_t b) {
+		std::swap(m_heap[a], m_heap[b]);
+		m_positions[m_heap[a].id] = static_cast<uint32_t>(a);
+		m_positions[m_heap[b].id] = static_cast<uint32_t>(b);
+	}
+
+	void siftUp(size_t position) {
+		while (position > 0 && m_heap[parent(position)].key < m_heap[position].key) {
+			swapEntries(position, parent(position));
+			position = parent(position);
+		}
+	}
+
+	void siftDown(size_t position) {
+		const size_t size = m_heap.size();
+		while (true) {
+			const size_t left = 2 * position + 1;
+			const size_t right = left + 1;
+			size_t largest = position;
+			if (left < size && m_heap[left].key > m_heap[largest].key) {
+				largest = left;
+			}
+			if (right < size && m_heap[right].key > m_heap[largest].key) {
+				largest = right;
+			}
+			if (largest == position) {
+				return;
+			}
+			swapEntries(position, largest);
+			position = largest;
+		}
+	}
+
+	std::vector<Entry> m_heap;
+	std::vector<uint32_t> m_positions; // Position of each id in m_heap
+};
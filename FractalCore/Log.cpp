@@ -0,0 +1,173 @@
+#include "pch.h"
+
+#include "Log.h"
+
+namespace {
+	constexpr size_t queueCapacity = 1024; // Power of two
+
+	struct Record {
+		logging::Level level = logging::Level::Info;
+		std::chrono::steady_clock::time_point time;
+		std::thread::id thread;
+		std::string message;
+	};
+
+	// Bounded queue for any number of producers and a single consumer, after Dmitry Vyukov's.
+	// The sequence number of a slot tells whether it is free for the producer of a position
+	// or holds a record for the consumer.
+	class RecordQueue
+	{
+	public:
+		RecordQueue() {
+			for (size_t i = 0; i < queueCapacity; ++i) {
+				m_slots[i].sequence.store(i, std::memory_order_relaxed);
+			}
+		}
+
+		bool tryPush(Record&& record) {
+			size_t position = m_tail.load(std::memory_order_relaxed);
+			while (true) {
+				Slot& slot = m_slots[position % queueCapacity];
+				const size_t sequence = slot.sequence.load(std::memory_order_acquire);
+				if (sequence == position) {
+					if (m_tail.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+						slot.record = std::move(record);
+						slot.sequence.store(position + 1, std::memory_order_release);
+						return true;
+					}
+				}
+				else if (sequence < position) {
+					return false; // Full, the consumer hasn't taken the record a lap ago yet
+				}
+				else {
+					position = m_tail.load(std::memory_order_relaxed);
+				}
+			}
+		}
+
+		// Only from the consumer thread
+		bool tryPop(Record& record) {
+			Slot& slot = m_slots[m_head % queueCapacity];
+			if (slot.sequence.load(std::memory_order_acquire) != m_head + 1) {
+				return false;
+			}
+			record = std::move(slot.record);
+			slot.sequence.store(m_head + queueCapacity, std::memory_order_release);
+			++m_head;
+			return true;
+		}
+
+	private:
+		struct Slot {
+			std::atomic<size_t> sequence;
+			Record record;
+		};
+
+		std::unique_ptr<Slot[]> m_slots = std::make_unique<Slot[]>(queueCapacity);
+		std::atomic<size_t> m_tail = 0;
+		size_t m_head = 0;
+	};
+
+	constexpr const char* levelNames[] = { "trace", "debug", "info", "warning", "error" };
+
+	class Logger
+	{
+	public:
+		Logger() : m_thread(&Logger::run, this) {}
+
+		~Logger() {
+			m_stop = true;
+			wakeUp();
+			m_thread.join();
+		}
+
+		void write(Record&& record) {
+			if (!m_queue.tryPush(std::move(record))) {
+				m_dropped.fetch_add(1, std::memory_order_relaxed);
+				return;
+			}
+			m_queued.fetch_add(1, std::memory_order_release);
+			wakeUp();
+		}
+
+		void flush() {
+			const uint64_t queued = m_queued.load(std::memory_order_acquire);
+			uint64_t written = m_written.load(std::memory_order_acquire);
+			while (written < queued) {
+				m_written.wait(written);
+				written = m_written.load(std::memory_order_acquire);
+			}
+		}
+
+	private:
+		void wakeUp() {
+			m_signal.fetch_add(1, std::memory_order_release);
+			m_signal.notify_one();
+		}
+
+		void run() {
+			Record record;
+			std::ostringstream line;
+			line.precision(3);
+			line << std::fixed;
+			uint64_t written = 0;
+			uint64_t droppedReported = 0;
+			while (true) {
+				// Anything queued after this is either drained below or changes the signal before the wait
+				const uint32_t signal = m_signal.load(std::memory_order_acquire);
+
+				bool any = false;
+				while (m_queue.tryPop(record)) {
+					const double seconds = std::chrono::duration<double>(record.time - m_start).count();
+					line.str({});
+					line << '[' << seconds << "] [" << levelNames[static_cast<int>(record.level)] << "] ["
+						<< record.thread << "] " << record.message << '\n';
+					std::cout << line.view();
+					++written;
+					any = true;
+				}
+				const uint64_t dropped = m_dropped.load(std::memory_order_relaxed);
+				if (dropped != droppedReported) {
+					std::cout << "[log] " << dropped - droppedReported << " messages dropped\n";
+					droppedReported = dropped;
+					any = true;
+				}
+				if (any) {
+					std::cout.flush();
+					m_written.store(written, std::memory_order_release);
+					m_written.notify_all();
+				}
+
+				if (m_stop) {
+					return;
+				}
+				m_signal.wait(signal, std::memory_order_acquire);
+			}
+		}
+
+		RecordQueue m_queue;
+		const std::chrono::steady_clock::time_point m_start = std::chrono::steady_clock::now();
+		std::atomic<uint64_t> m_queued = 0;
+		std::atomic<uint64_t> m_written = 0;
+		std::atomic<uint64_t> m_dropped = 0;
+		std::atomic<uint32_t> m_signal = 0;
+		std::atomic<bool> m_stop = false;
+		std::thread m_thread; // Last so that everything else is initialized before the thread starts
+	};
+
+	Logger& logger()
+	{
+		static Logger logger;
+		return logger;
+	}
+}
+
+void logging::write(Level level, std::string message)
+{
+	logger().write(Record{ level, std::chrono::steady_clock::now(), std::this_thread::get_id(), std::move(message) });
+}
+
+void logging::flush()
+{
+	logger().flush();
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+// Leveled logging that never waits for the console. Messages are formatted by the caller and handed
+// to a background thread through a lock-free queue. Levels below FE_LOG_LEVEL are compiled out
+// together with their arguments.
+
+#define FE_LOG_LEVEL_TRACE 0
+#define FE_LOG_LEVEL_DEBUG 1
+#define FE_LOG_LEVEL_INFO 2
+#define FE_LOG_LEVEL_WARNING 3
+#define FE_LOG_LEVEL_ERROR 4
+
+#ifndef FE_LOG_LEVEL
+#ifdef NDEBUG
+#define FE_LOG_LEVEL FE_LOG_LEVEL_INFO
+#else
+#define FE_LOG_LEVEL FE_LOG_LEVEL_DEBUG
+#endif
+#endif
+
+namespace logging {
+
+	enum class Level {
+		Trace = FE_LOG_LEVEL_TRACE,
+		Debug = FE_LOG_LEVEL_DEBUG,
+		Info = FE_LOG_LEVEL_INFO,
+		Warning = FE_LOG_LEVEL_WARNING,
+		Error = FE_LOG_LEVEL_ERROR
+	};
+
+	// Queues the message for the logging thread. When the queue is full the message is dropped and counted.
+	void write(Level level, std::string message);
+
+	// Waits until everything written before is on the console
+	void flush();
+
+	template<typename... Args>
+	void log(Level level, const Args&... args) {
+		std::ostringstream stream;
+		(stream << ... << args);
+		write(level, std::move(stream).str());
+	}
+}
+
+#if FE_LOG_LEVEL <= FE_LOG_LEVEL_TRACE
+#define FE_LOG_TRACE(...) ::logging::log(::logging::Level::Trace, __VA_ARGS__)
+#else
+#define FE_LOG_TRACE(...) ((void)0)
+#endif
+
+#if FE_LOG_LEVEL <= FE_LOG_LEVEL_DEBUG
+#define FE_LOG_DEBUG(...) ::logging::log(::logging::Level::Debug, __VA_ARGS__)
+#else
+#define FE_LOG_DEBUG(...) ((void)0)
+#endif
+
+#if FE_LOG_LEVEL <= FE_LOG_LEVEL_INFO
+#define FE_LOG_INFO(...) ::logging::log(::logging::Level::Info, __VA_ARGS__)
+#else
+#define FE_LOG_INFO(...) ((void)0)
+#endif
+
+#if FE_LOG_LEVEL <= FE_LOG_LEVEL_WARNING
+#define FE_LOG_WARNING(...) ::logging::log(::logging::Level::Warning, __VA_ARGS__)
+#else
+#define FE_LOG_WARNING(...) ((void)0)
+#endif
+
+#define FE_LOG_ERROR(...) ::logging::log(::logging::Level::Error, __VA_ARGS__)
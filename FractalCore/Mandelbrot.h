@@ -0,0 +1,153 @@
+﻿#pragma once
+
+#include "Formula.h"
+
+namespace mandelbrot {
+
+	struct EscapeResult {
+		int iterations; // maxIter if the point didn't escape
+		std::complex<double> z;
+		int period; // Period of the orbit if it was found to be periodic, otherwise 0
+	};
+
+	// Points inside these never escape: z = z^2 + c has an attracting fixed point in the
+	// main cardioid and an attracting 2-cycle in the bulb left of it
+	template<typename NumericType>
+	constexpr bool isInMainCardioid(NumericType real, NumericType imag) {
+		const NumericType x = real - NumericType(0.25);
+		const NumericType y2 = imag * imag;
+		const NumericType q = x * x + y2;
+		return q * (q + x) <= NumericType(0.25) * y2;
+	}
+
+	template<typename NumericType>
+	constexpr bool isInPeriod2Bulb(NumericType real, NumericType imag) {
+		const NumericType x = real + NumericType(1);
+		return x * x + imag * imag <= NumericType(1.0 / 16);
+	}
+
+	// Orbit points closer than this to an earlier one are considered to repeat it
+	template<typename NumericType>
+	constexpr NumericType periodicityTolerance() {
+		return std::numeric_limits<NumericType>::epsilon() * 16;
+	}
+
+	// Observer of iterateUntilEscape that does nothing
+	struct NoObserver {
+		template<typename NumericType>
+		constexpr void operator()(const NumericType&, const NumericType&) const {}
+	};
+
+	// Iterates the formula from z until |z| >= 4 or maxIter. Interior points are recognized early by finding
+	// a cycle in the orbit with Brent's method: the orbit is compared to a saved point that is moved
+	// forward after 1, 2, 4, 8... iterations, so a cycle is found within a few times its length.
+	// NumericType can be any type with the arithmetic operators, comparisons, abs and numeric_limits.
+	// observer is called with every z before the step from it.
+	template<typename F, typename NumericType, typename Observer = NoObserver>
+	constexpr EscapeResult iterateUntilEscape(NumericType zr, NumericType zi, const NumericType& cr, const NumericType& ci, int maxIter,
+		Observer&& observer = {}) {
+		using std::abs;
+		const NumericType bailout = 16;
+		const NumericType tolerance = periodicityTolerance<NumericType>();
+		NumericType zr2 = square(zr);
+		NumericType zi2 = square(zi);
+		NumericType savedZr = zr;
+		NumericType savedZi = zi;
+		int checkLength = 1;
+		int sinceSaved = 0;
+		int n = 0;
+		while (zr2 + zi2 < bailout && n < maxIter) {
+			observer(zr, zi);
+			iterateFormula<F>(zr, zi, zr2, zi2, cr, ci);
+			++n;
+			++sinceSaved;
+
+			if (abs(zr - savedZr) < tolerance && abs(zi - savedZi) < tolerance) {
+				return { maxIter, { static_cast<double>(zr), static_cast<double>(zi) }, sinceSaved };
+			}
+			if (sinceSaved == checkLength) {
+				savedZr = zr;
+				savedZi = zi;
+				sinceSaved = 0;
+				checkLength *= 2;
+			}
+		}
+		return { n, { static_cast<double>(zr), static_cast<double>(zi) }, 0 };
+	}
+
+	// Escape time of the point (pr, pi) with any formula. The orbit starts from the point,
+	// which also is c except for the Julia family that adds juliaConstant instead.
+	template<typename F, typename NumericType>
+	constexpr EscapeResult calculateFormulaEscapeTime(const NumericType& pr, const NumericType& pi, int maxIter,
+		std::complex<double> juliaConstant = {}) {
+		if constexpr (F::family == Family::Julia) {
+			return iterateUntilEscape<F>(pr, pi, NumericType(juliaConstant.real()), NumericType(juliaConstant.imag()), maxIter);
+		}
+		else {
+			if constexpr (std::is_same_v<F, Mandelbrot>) {
+				const std::complex<double> c{ static_cast<double>(pr), static_cast<double>(pi) };
+				if (isInMainCardioid(pr, pi)) {
+					return { maxIter, c, 1 };
+				}
+				if (isInPeriod2Bulb(pr, pi)) {
+					return { maxIter, c, 2 };
+				}
+			}
+			return iterateUntilEscape<F>(pr, pi, pr, pi, maxIter);
+		}
+	}
+
+	// Escape time of c in the Mandelbrot set. Points inside the main cardioid and the period 2 bulb
+	// are recognized analytically, other interior points by the cycle of their orbit.
+	template<typename NumericType>
+	constexpr EscapeResult calculateEscapeTime(const NumericType& cr, const NumericType& ci, int maxIter) {
+		return calculateFormulaEscapeTime<Mandelbrot>(cr, ci, maxIter);
+	}
+
+	template<typename NumericType>
+	constexpr EscapeResult calculateEscapeTime(std::complex<NumericType> start, int maxIter) {
+		return calculateEscapeTime(start.real(), start.imag(), maxIter);
+	}
+
+	struct DistanceResult {
+		EscapeResult escape;
+		double distance; // Estimated distance to the boundary of the set, infinity for interior points
+	};
+
+	// Escape time of c in the Mandelbrot set together with the distance estimate |z| ln|z| / |dz/dc|.
+	// The derivative follows the orbit, dz/dc = 2 z dz/dc + 1 starting from 1 for z = c.
+	template<typename NumericType>
+	DistanceResult calculateDistanceEstimate(const NumericType& cr, const NumericType& ci, int maxIter) {
+		if (isInMainCardioid(cr, ci) || isInPeriod2Bulb(cr, ci)) {
+			return { calculateEscapeTime(cr, ci, maxIter), std::numeric_limits<double>::infinity() };
+		}
+
+		NumericType dzr = 1;
+		NumericType dzi = 0;
+		const auto escape = iterateUntilEscape<Mandelbrot>(cr, ci, cr, ci, maxIter, [&](const NumericType& zr, const NumericType& zi) {
+			const NumericType nextDzr = 2 * (zr * dzr - zi * dzi) + 1;
+			dzi = 2 * (zr * dzi + zi * dzr);
+			dzr = nextDzr;
+		});
+		if (escape.iterations == maxIter) {
+			return { escape, std::numeric_limits<double>::infinity() };
+		}
+		const double absZ = std::abs(escape.z);
+		const double absDz = std::hypot(static_cast<double>(dzr), static_cast<double>(dzi));
+		return { escape, absZ * std::log(absZ) / absDz };
+	}
+
+	// Continuous iteration count from the discrete one and the absolute value of the final z.
+	// |z| grows to about its exponent'th power every iteration near the bailout.
+	inline double smoothIterationCount(int iterations, double absZ, int maxIter, int exponent = 2) {
+		return iterations < maxIter
+			? iterations - std::clamp(std::log(std::log(absZ)) / std::log(static_cast<double>(exponent)), 0.0, 1.0)
+			: static_cast<double>(maxIter);
+	}
+
+	template<typename NumericType>
+	constexpr double calculateSmoothEscapeTime(std::complex<NumericType> start, int maxIter) {
+		const auto result = calculateEscapeTime(start, maxIter);
+		return smoothIterationCount(result.iterations, std::abs(result.z), maxIter);
+	}
+}
\ No newline at end of file
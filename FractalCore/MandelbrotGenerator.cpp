@@ -0,0 +1,139 @@
+#include "pch.h"
+
+#include "MandelbrotGenerator.h"
+#include "MandelbrotSimd.h"
+#include "Mandelbrot.h"
+#include "Precision.h"
+#include "Profiler.h"
+
+namespace {
+	// The mesh is refined to about the resolution of the window
+	constexpr double samplesAcross = 1280;
+}
+
+void MandelbrotVertexGenerator::generate(std::span<const glm::vec2> positions, std::span<float> escapeTimes, double scale, int maxIter) const
+{
+	generateSamples(positions, escapeTimes, {}, scale, maxIter);
+}
+
+void MandelbrotVertexGenerator::generate(std::span<const glm::vec2> positions, std::span<float> escapeTimes, std::span<float> distances,
+	double scale, int maxIter) const
+{
+	if (m_estimateDistance) {
+		generateSamples(positions, escapeTimes, distances, scale, maxIter);
+	}
+	else {
+		generateSamples(positions, escapeTimes, {}, scale, maxIter);
+		std::ranges::fill(distances, std::numeric_limits<float>::infinity());
+	}
+}
+
+void MandelbrotVertexGenerator::generateSamples(std::span<const glm::vec2> positions, std::span<float> escapeTimes, std::span<float> distances,
+	double scale, int maxIter) const
+{
+	const bool withDistance = !distances.empty();
+	// The positions are floats, so going past double would not add anything. The distance estimate
+	// is only implemented in double, the derivative overflows float quickly.
+	const auto precision = withDistance ? mandelbrot::Precision::Double
+		: std::min(mandelbrot::precisionForPixelSize(scale / samplesAcross), mandelbrot::Precision::Double);
+
+	constexpr size_t chunkSize = 256;
+	EscapeSample samples[chunkSize];
+	bool found[chunkSize];
+	// The kernel wants the coordinates of the missing samples as separate arrays
+	glm::vec2 missing[chunkSize];
+	size_t missingIndex[chunkSize];
+	float real[chunkSize];
+	float imag[chunkSize];
+	int iterations[chunkSize];
+	float zReal[chunkSize];
+	float zImag[chunkSize];
+	EscapeSample calculated[chunkSize];
+
+	for (size_t start = 0; start < positions.size(); start += chunkSize) {
+		const size_t count = std::min(chunkSize, positions.size() - start);
+		const auto chunk = positions.subspan(start, count);
+		m_cache->lookup(chunk, maxIter, precision, { samples, count }, { found, count }, withDistance);
+
+		size_t missingCount = 0;
+		for (size_t i = 0; i < count; ++i) {
+			if (!found[i]) {
+				missing[missingCount] = chunk[i];
+				missingIndex[missingCount] = i;
+				real[missingCount] = chunk[i].x;
+				imag[missingCount] = chunk[i].y;
+				++missingCount;
+			}
+		}
+
+		if (precision == mandelbrot::Precision::Float) {
+			mandelbrot::calculateEscapeTimeBatch({ real, missingCount }, { imag, missingCount }, maxIter,
+				{ iterations, missingCount }, { zReal, missingCount }, { zImag, missingCount });
+			for (size_t i = 0; i < missingCount; ++i) {
+				calculated[i] = EscapeSample{ iterations[i], { zReal[i], zImag[i] } };
+			}
+		}
+		else if (withDistance) {
+			for (size_t i = 0; i < missingCount; ++i) {
+				const auto result = mandelbrot::calculateDistanceEstimate<double>(real[i], imag[i], maxIter);
+				calculated[i] = EscapeSample{ result.escape.iterations, std::complex<float>(result.escape.z),
+					static_cast<float>(result.distance) };
+			}
+		}
+		else {
+			for (size_t i = 0; i < missingCount; ++i) {
+				const auto escape = mandelbrot::calculateEscapeTime<double>(real[i], imag[i], maxIter);
+				calculated[i] = EscapeSample{ escape.iterations, std::complex<float>(escape.z) };
+			}
+		}
+		for (size_t i = 0; i < missingCount; ++i) {
+			samples[missingIndex[i]] = calculated[i];
+		}
+		m_cache->insert({ missing, missingCount }, maxIter, precision, { calculated, missingCount });
+
+		uint64_t iterationsCalculated = 0;
+		for (size_t i = 0; i < missingCount; ++i) {
+			iterationsCalculated += calculated[i].iterations;
+		}
+		profiler::add(profiler::Counter::Samples, count);
+		profiler::add(profiler::Counter::CacheHits, count - missingCount);
+		profiler::add(profiler::Counter::CacheMisses, missingCount);
+		profiler::add(profiler::Counter::Iterations, iterationsCalculated);
+
+		for (size_t i = 0; i < count; ++i) {
+			escapeTimes[start + i] = static_cast<float>(mandelbrot::smoothIterationCount(samples[i].iterations, std::abs(samples[i].z), maxIter));
+		}
+		if (withDistance) {
+			for (size_t i = 0; i < count; ++i) {
+				distances[start + i] = samples[i].distance;
+			}
+		}
+	}
+}
+
+FormulaVertexGenerator::FormulaVertexGenerator(const mandelbrot::FormulaId& formula, std::complex<double> juliaConstant)
+	: m_kernel(mandelbrot::findFormulaKernel(formula))
+	, m_juliaConstant(juliaConstant)
+{
+	assert(m_kernel);
+}
+
+void FormulaVertexGenerator::generate(std::span<const glm::vec2> positions, std::span<float> escapeTimes, double, int maxIter) const
+{
+	constexpr size_t chunkSize = 256;
+	double real[chunkSize];
+	double imag[chunkSize];
+	double result[chunkSize];
+	for (size_t start = 0; start < positions.size(); start += chunkSize) {
+		const size_t count = std::min(chunkSize, positions.size() - start);
+		for (size_t i = 0; i < count; ++i) {
+			real[i] = positions[start + i].x;
+			imag[i] = positions[start + i].y;
+		}
+		m_kernel({ real, count }, { imag, count }, m_juliaConstant, maxIter, { result, count });
+		for (size_t i = 0; i < count; ++i) {
+			escapeTimes[start + i] = static_cast<float>(result[i]);
+		}
+		profiler::add(profiler::Counter::Samples, count);
+	}
+}
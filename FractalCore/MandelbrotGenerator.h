@@ -0,0 +1,43 @@
+#pragma once
+
+#include "TriangleHandler.h"
+#include "SampleCache.h"
+#include "Formula.h"
+
+// Gives vertices the smooth escape time of the Mandelbrot set, using the simd kernel.
+// Switches to double precision when the view gets too small for float.
+// Positions that were evaluated before are taken from the sample cache.
+// With estimateDistance the vertices also get distance estimates, calculated in double precision
+// without the simd kernel, which makes the mesh concentrate on the boundary of the set.
+class MandelbrotVertexGenerator {
+public:
+	explicit MandelbrotVertexGenerator(std::shared_ptr<SampleCache> cache = std::make_shared<SampleCache>(), bool estimateDistance = false)
+		: m_cache(std::move(cache)), m_estimateDistance(estimateDistance) {}
+
+	void generate(std::span<const glm::vec2> positions, std::span<float> escapeTimes, double scale, int maxIter) const;
+	void generate(std::span<const glm::vec2> positions, std::span<float> escapeTimes, std::span<float> distances,
+		double scale, int maxIter) const;
+
+	const std::shared_ptr<SampleCache>& getCache() const { return m_cache; }
+
+private:
+	// Distances are estimated if distances isn't empty
+	void generateSamples(std::span<const glm::vec2> positions, std::span<float> escapeTimes, std::span<float> distances,
+		double scale, int maxIter) const;
+
+	std::shared_ptr<SampleCache> m_cache;
+	bool m_estimateDistance;
+};
+
+// Gives vertices the smooth escape time of any formula of the dispatch table, in double precision.
+// Not cached, the cache doesn't tell the formulas apart.
+class FormulaVertexGenerator {
+public:
+	FormulaVertexGenerator(const mandelbrot::FormulaId& formula, std::complex<double> juliaConstant = {});
+
+	void generate(std::span<const glm::vec2> positions, std::span<float> escapeTimes, double scale, int maxIter) const;
+
+private:
+	mandelbrot::FormulaKernel m_kernel;
+	std::complex<double> m_juliaConstant;
+};
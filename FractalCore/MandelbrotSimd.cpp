@@ -0,0 +1,479 @@
+#include "pch.h"
+
+#include "MandelbrotSimd.h"
+#include "Mandelbrot.h"
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define FE_SIMD_X86 1
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+// Msvc allows intrinsics of any instruction set, gcc and clang need them enabled per function
+#if defined(FE_SIMD_X86) && !defined(_MSC_VER)
+#define FE_TARGET_AVX2 __attribute__((target("avx2")))
+#define FE_TARGET_AVX512 __attribute__((target("avx512f")))
+#else
+#define FE_TARGET_AVX2
+#define FE_TARGET_AVX512
+#endif
+
+namespace mandelbrot {
+
+	namespace {
+
+		constexpr float bailout = 16.0f;
+
+		// Once no points are left to start, the last few lanes of a vector are finished one at a time.
+		// A vector step costs about as much as this many scalar ones.
+		constexpr int scalarTailLanes = 4;
+
+		void escapeTimeScalar(const float* real, const float* imag, size_t count, int maxIter, int* iterations, float* zReal, float* zImag, int* periods) {
+			for (size_t i = 0; i < count; ++i) {
+				const auto result = calculateEscapeTime(real[i], imag[i], maxIter);
+				iterations[i] = result.iterations;
+				zReal[i] = static_cast<float>(result.z.real());
+				zImag[i] = static_cast<float>(result.z.imag());
+				periods[i] = result.period;
+			}
+		}
+
+		// State of a point in a vector lane, laid out like the loop of iterateUntilEscape
+		struct LaneState {
+			float cr, ci, zr, zi, savedZr, savedZi;
+			int n, sinceSaved, checkLength;
+		};
+
+		// Continues the orbit of a lane where the vector kernel left it, with the same steps and cycle checks
+		void finishLane(LaneState lane, int maxIter, int& iterations, float& zReal, float& zImag, int& period) {
+			const float tolerance = periodicityTolerance<float>();
+			period = 0;
+			while (lane.zr * lane.zr + lane.zi * lane.zi < bailout && lane.n < maxIter) {
+				const float zr2 = lane.zr * lane.zr;
+				const float zi2 = lane.zi * lane.zi;
+				const float zrzi = lane.zr * lane.zi;
+				lane.zr = (zr2 - zi2) + lane.cr;
+				lane.zi = (zrzi + zrzi) + lane.ci;
+				++lane.n;
+				++lane.sinceSaved;
+				if (std::abs(lane.zr - lane.savedZr) < tolerance && std::abs(lane.zi - lane.savedZi) < tolerance) {
+					lane.n = maxIter;
+					period = lane.sinceSaved;
+					break;
+				}
+				if (lane.sinceSaved == lane.checkLength) {
+					lane.savedZr = lane.zr;
+					lane.savedZi = lane.zi;
+					lane.sinceSaved = 0;
+					lane.checkLength *= 2;
+				}
+			}
+			iterations = lane.n;
+			zReal = lane.zr;
+			zImag = lane.zi;
+		}
+
+		// The lanes of bits that are left when only the lowest count of them are kept
+		constexpr unsigned lowestBits(unsigned bits, size_t count) {
+			while (static_cast<size_t>(std::popcount(bits)) > count) {
+				bits &= ~(1u << (31 - std::countl_zero(bits)));
+			}
+			return bits;
+		}
+
+#ifdef FE_SIMD_X86
+
+		// The vector kernels work through the points like a queue. Every lane iterates its own point, and a lane
+		// whose point escaped, reached maxIter or was found periodic writes it out and takes the next one. A slow
+		// point then only keeps its own lane busy instead of the whole vector. The cycle check is the one of
+		// iterateUntilEscape, per lane, so the results are the same as those of the scalar float code.
+
+		FE_TARGET_AVX2 inline __m256i laneMask(unsigned bits) {
+			const __m256i laneBits = _mm256_setr_epi32(1, 2, 4, 8, 16, 32, 64, 128);
+			return _mm256_cmpeq_epi32(_mm256_and_si256(_mm256_set1_epi32(static_cast<int>(bits)), laneBits), laneBits);
+		}
+
+		FE_TARGET_AVX2 void escapeTimeAvx2(const float* real, const float* imag, size_t count, int maxIter, int* iterations, float* zReal, float* zImag, int* periods) {
+			// Without points no lane would ever finish and the loop below would not end
+			if (count == 0) {
+				return;
+			}
+			// A lane is done once it reached maxIter, which a negative count never would
+			maxIter = std::max(maxIter, 0);
+			constexpr unsigned allLanes = 0xff;
+			const __m256 limit = _mm256_set1_ps(bailout);
+			const __m256 tolerance = _mm256_set1_ps(periodicityTolerance<float>());
+			const __m256 signMask = _mm256_set1_ps(-0.0f);
+			const __m256i one = _mm256_set1_epi32(1);
+			const __m256i maxN = _mm256_set1_epi32(maxIter);
+			__m256 cr = _mm256_setzero_ps(), ci = cr, zr = cr, zi = cr, savedZr = cr, savedZi = cr;
+			__m256i n = _mm256_setzero_si256(), sinceSaved = n, checkLength = one, index = n;
+			unsigned occupied = 0;
+			unsigned periodic = 0;
+			size_t next = 0;
+
+			while (true) {
+				const __m256 zr2 = _mm256_mul_ps(zr, zr);
+				const __m256 zi2 = _mm256_mul_ps(zi, zi);
+				const unsigned escaped = _mm256_movemask_ps(_mm256_cmp_ps(_mm256_add_ps(zr2, zi2), limit, _CMP_NLT_UQ));
+				const unsigned maxed = _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(n, maxN)));
+				const unsigned finished = occupied & (escaped | maxed | periodic);
+
+				if (finished != 0 || (occupied != allLanes && next < count)) {
+					if (finished != 0) {
+						alignas(32) int laneIndex[8], laneN[8], laneSinceSaved[8];
+						alignas(32) float laneZr[8], laneZi[8];
+						_mm256_store_si256(reinterpret_cast<__m256i*>(laneIndex), index);
+						_mm256_store_si256(reinterpret_cast<__m256i*>(laneN), n);
+						_mm256_store_si256(reinterpret_cast<__m256i*>(laneSinceSaved), sinceSaved);
+						_mm256_store_ps(laneZr, zr);
+						_mm256_store_ps(laneZi, zi);
+						for (unsigned bits = finished; bits != 0; bits &= bits - 1) {
+							const int lane = std::countr_zero(bits);
+							const int i = laneIndex[lane];
+							// Periodic lanes never escape
+							const bool isPeriodic = (periodic >> lane) & 1;
+							iterations[i] = isPeriodic ? maxIter : laneN[lane];
+							zReal[i] = laneZr[lane];
+							zImag[i] = laneZi[lane];
+							periods[i] = isPeriodic ? laneSinceSaved[lane] : 0;
+						}
+						occupied &= ~finished;
+						periodic &= ~finished;
+					}
+
+					// The free lanes take the next points in order
+					const unsigned refill = lowestBits(~occupied & allLanes, count - next);
+					if (refill != 0) {
+						alignas(32) int laneIndex[8];
+						_mm256_store_si256(reinterpret_cast<__m256i*>(laneIndex), index);
+						for (unsigned bits = refill; bits != 0; bits &= bits - 1) {
+							laneIndex[std::countr_zero(bits)] = static_cast<int>(next++);
+						}
+						index = _mm256_load_si256(reinterpret_cast<const __m256i*>(laneIndex));
+						const __m256 mask = _mm256_castsi256_ps(laneMask(refill));
+						cr = _mm256_mask_i32gather_ps(cr, real, index, mask, 4);
+						ci = _mm256_mask_i32gather_ps(ci, imag, index, mask, 4);
+						occupied |= refill;
+					}
+					if (occupied == 0) {
+						return;
+					}
+
+					// Everything restarts from c in the new lanes, and free lanes sit at 0 which never changes
+					const __m256 restart = _mm256_castsi256_ps(laneMask(refill));
+					const __m256 keep = _mm256_castsi256_ps(laneMask(occupied));
+					cr = _mm256_and_ps(cr, keep);
+					ci = _mm256_and_ps(ci, keep);
+					zr = _mm256_and_ps(_mm256_blendv_ps(zr, cr, restart), keep);
+					zi = _mm256_and_ps(_mm256_blendv_ps(zi, ci, restart), keep);
+					savedZr = _mm256_blendv_ps(savedZr, zr, restart);
+					savedZi = _mm256_blendv_ps(savedZi, zi, restart);
+					n = _mm256_andnot_si256(_mm256_castps_si256(restart), n);
+					sinceSaved = _mm256_andnot_si256(_mm256_castps_si256(restart), sinceSaved);
+					checkLength = _mm256_castps_si256(_mm256_blendv_ps(_mm256_castsi256_ps(checkLength), _mm256_castsi256_ps(one), restart));
+
+					if (next == count && std::popcount(occupied) <= scalarTailLanes) {
+						alignas(32) float laneFloats[6][8];
+						alignas(32) int laneInts[4][8];
+						_mm256_store_ps(laneFloats[0], cr);
+						_mm256_store_ps(laneFloats[1], ci);
+						_mm256_store_ps(laneFloats[2], zr);
+						_mm256_store_ps(laneFloats[3], zi);
+						_mm256_store_ps(laneFloats[4], savedZr);
+						_mm256_store_ps(laneFloats[5], savedZi);
+						_mm256_store_si256(reinterpret_cast<__m256i*>(laneInts[0]), n);
+						_mm256_store_si256(reinterpret_cast<__m256i*>(laneInts[1]), sinceSaved);
+						_mm256_store_si256(reinterpret_cast<__m256i*>(laneInts[2]), checkLength);
+						_mm256_store_si256(reinterpret_cast<__m256i*>(laneInts[3]), index);
+						for (unsigned bits = occupied; bits != 0; bits &= bits - 1) {
+							const int lane = std::countr_zero(bits);
+							const LaneState state{ laneFloats[0][lane], laneFloats[1][lane], laneFloats[2][lane], laneFloats[3][lane],
+								laneFloats[4][lane], laneFloats[5][lane], laneInts[0][lane], laneInts[1][lane], laneInts[2][lane] };
+							const int i = laneInts[3][lane];
+							finishLane(state, maxIter, iterations[i], zReal[i], zImag[i], periods[i]);
+						}
+						return;
+					}
+					continue;
+				}
+
+				const __m256 zrzi = _mm256_mul_ps(zr, zi);
+				zr = _mm256_add_ps(_mm256_sub_ps(zr2, zi2), cr);
+				zi = _mm256_add_ps(_mm256_add_ps(zrzi, zrzi), ci);
+				n = _mm256_add_epi32(n, one);
+				sinceSaved = _mm256_add_epi32(sinceSaved, one);
+
+				const __m256 distance = _mm256_max_ps(
+					_mm256_andnot_ps(signMask, _mm256_sub_ps(zr, savedZr)),
+					_mm256_andnot_ps(signMask, _mm256_sub_ps(zi, savedZi)));
+				const __m256 repeats = _mm256_cmp_ps(distance, tolerance, _CMP_LT_OQ);
+				periodic = occupied & _mm256_movemask_ps(repeats);
+
+				// A periodic lane keeps sinceSaved as its period
+				const __m256 save = _mm256_andnot_ps(repeats, _mm256_castsi256_ps(_mm256_cmpeq_epi32(sinceSaved, checkLength)));
+				savedZr = _mm256_blendv_ps(savedZr, zr, save);
+				savedZi = _mm256_blendv_ps(savedZi, zi, save);
+				sinceSaved = _mm256_andnot_si256(_mm256_castps_si256(save), sinceSaved);
+				checkLength = _mm256_castps_si256(_mm256_blendv_ps(_mm256_castsi256_ps(checkLength),
+					_mm256_castsi256_ps(_mm256_slli_epi32(checkLength, 1)), save));
+			}
+		}
+
+		FE_TARGET_AVX512 void escapeTimeAvx512(const float* real, const float* imag, size_t count, int maxIter, int* iterations, float* zReal, float* zImag, int* periods) {
+			// Without points no lane would ever finish and the loop below would not end
+			if (count == 0) {
+				return;
+			}
+			// A lane is done once it reached maxIter, which a negative count never would
+			maxIter = std::max(maxIter, 0);
+			constexpr __mmask16 allLanes = 0xffff;
+			const __m512 limit = _mm512_set1_ps(bailout);
+			const __m512 tolerance = _mm512_set1_ps(periodicityTolerance<float>());
+			const __m512i one = _mm512_set1_epi32(1);
+			const __m512i maxN = _mm512_set1_epi32(maxIter);
+			const __m512i laneNumbers = _mm512_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+			__m512 cr = _mm512_setzero_ps(), ci = cr, zr = cr, zi = cr, savedZr = cr, savedZi = cr;
+			__m512i n = _mm512_setzero_si512(), sinceSaved = n, checkLength = one, index = n;
+			__mmask16 occupied = 0;
+			__mmask16 periodic = 0;
+			size_t next = 0;
+
+			while (true) {
+				const __m512 zr2 = _mm512_mul_ps(zr, zr);
+				const __m512 zi2 = _mm512_mul_ps(zi, zi);
+				const __mmask16 escaped = _mm512_cmp_ps_mask(_mm512_add_ps(zr2, zi2), limit, _CMP_NLT_UQ);
+				const __mmask16 finished = occupied & (escaped | periodic | _mm512_cmpeq_epi32_mask(n, maxN));
+
+				if (finished != 0 || (occupied != allLanes && next < count)) {
+					if (finished != 0) {
+						// Periodic lanes never escape
+						_mm512_mask_i32scatter_epi32(iterations, finished, index, _mm512_mask_mov_epi32(n, periodic, maxN), 4);
+						_mm512_mask_i32scatter_ps(zReal, finished, index, zr, 4);
+						_mm512_mask_i32scatter_ps(zImag, finished, index, zi, 4);
+						_mm512_mask_i32scatter_epi32(periods, finished, index, _mm512_maskz_mov_epi32(periodic, sinceSaved), 4);
+						occupied &= ~finished;
+						periodic &= ~finished;
+					}
+
+					// The free lanes take the next points in order
+					const __mmask16 refill = static_cast<__mmask16>(lowestBits(~occupied & allLanes, count - next));
+					if (refill != 0) {
+						cr = _mm512_mask_expandloadu_ps(cr, refill, real + next);
+						ci = _mm512_mask_expandloadu_ps(ci, refill, imag + next);
+						index = _mm512_mask_expand_epi32(index, refill, _mm512_add_epi32(_mm512_set1_epi32(static_cast<int>(next)), laneNumbers));
+						next += std::popcount(static_cast<unsigned>(refill));
+						occupied |= refill;
+					}
+					if (occupied == 0) {
+						return;
+					}
+
+					// Everything restarts from c in the new lanes, and free lanes sit at 0 which never changes
+					cr = _mm512_maskz_mov_ps(occupied, cr);
+					ci = _mm512_maskz_mov_ps(occupied, ci);
+					zr = _mm512_maskz_mov_ps(occupied, _mm512_mask_mov_ps(zr, refill, cr));
+					zi = _mm512_maskz_mov_ps(occupied, _mm512_mask_mov_ps(zi, refill, ci));
+					savedZr = _mm512_mask_mov_ps(savedZr, refill, zr);
+					savedZi = _mm512_mask_mov_ps(savedZi, refill, zi);
+					n = _mm512_maskz_mov_epi32(~refill, n);
+					sinceSaved = _mm512_maskz_mov_epi32(~refill, sinceSaved);
+					checkLength = _mm512_mask_mov_epi32(checkLength, refill, one);
+
+					if (next == count && std::popcount(static_cast<unsigned>(occupied)) <= scalarTailLanes) {
+						alignas(64) float laneFloats[6][16];
+						alignas(64) int laneInts[4][16];
+						_mm512_store_ps(laneFloats[0], cr);
+						_mm512_store_ps(laneFloats[1], ci);
+						_mm512_store_ps(laneFloats[2], zr);
+						_mm512_store_ps(laneFloats[3], zi);
+						_mm512_store_ps(laneFloats[4], savedZr);
+						_mm512_store_ps(laneFloats[5], savedZi);
+						_mm512_store_si512(laneInts[0], n);
+						_mm512_store_si512(laneInts[1], sinceSaved);
+						_mm512_store_si512(laneInts[2], checkLength);
+						_mm512_store_si512(laneInts[3], index);
+						for (unsigned bits = occupied; bits != 0; bits &= bits - 1) {
+							const int lane = std::countr_zero(bits);
+							const LaneState state{ laneFloats[0][lane], laneFloats[1][lane], laneFloats[2][lane], laneFloats[3][lane],
+								laneFloats[4][lane], laneFloats[5][lane], laneInts[0][lane], laneInts[1][lane], laneInts[2][lane] };
+							const int i = laneInts[3][lane];
+							finishLane(state, maxIter, iterations[i], zReal[i], zImag[i], periods[i]);
+						}
+						return;
+					}
+					continue;
+				}
+
+				const __m512 zrzi = _mm512_mul_ps(zr, zi);
+				zr = _mm512_add_ps(_mm512_sub_ps(zr2, zi2), cr);
+				zi = _mm512_add_ps(_mm512_add_ps(zrzi, zrzi), ci);
+				n = _mm512_add_epi32(n, one);
+				sinceSaved = _mm512_add_epi32(sinceSaved, one);
+
+				const __m512 distance = _mm512_max_ps(
+					_mm512_abs_ps(_mm512_sub_ps(zr, savedZr)),
+					_mm512_abs_ps(_mm512_sub_ps(zi, savedZi)));
+				periodic = _mm512_mask_cmp_ps_mask(occupied, distance, tolerance, _CMP_LT_OQ);
+
+				// A periodic lane keeps sinceSaved as its period
+				const __mmask16 save = _mm512_mask_cmpeq_epi32_mask(~periodic, sinceSaved, checkLength);
+				savedZr = _mm512_mask_mov_ps(savedZr, save, zr);
+				savedZi = _mm512_mask_mov_ps(savedZi, save, zi);
+				sinceSaved = _mm512_maskz_mov_epi32(~save, sinceSaved);
+				checkLength = _mm512_mask_slli_epi32(checkLength, save, checkLength, 1);
+			}
+		}
+
+		bool osSupportsAvx512() {
+#ifdef _MSC_VER
+			int info[4];
+			__cpuid(info, 1);
+			const bool osxsave = (info[2] & (1 << 27)) != 0;
+			if (!osxsave) {
+				return false;
+			}
+			// xmm, ymm and the three avx512 state components
+			return (_xgetbv(0) & 0xe6) == 0xe6;
+#else
+			return true; // __builtin_cpu_supports already checks the os support
+#endif
+		}
+
+		SimdLevel detect() {
+#ifdef _MSC_VER
+			int info[4];
+			__cpuid(info, 0);
+			if (info[0] < 7) {
+				return SimdLevel::Scalar;
+			}
+			__cpuid(info, 1);
+			const bool osxsave = (info[2] & (1 << 27)) != 0;
+			const bool avx = (info[2] & (1 << 28)) != 0;
+			if (!osxsave || !avx || (_xgetbv(0) & 0x6) != 0x6) {
+				return SimdLevel::Scalar;
+			}
+			__cpuidex(info, 7, 0);
+			const bool avx2 = (info[1] & (1 << 5)) != 0;
+			const bool avx512f = (info[1] & (1 << 16)) != 0;
+#else
+			__builtin_cpu_init();
+			const bool avx2 = __builtin_cpu_supports("avx2");
+			const bool avx512f = __builtin_cpu_supports("avx512f");
+#endif
+			if (avx512f && osSupportsAvx512()) {
+				return SimdLevel::Avx512;
+			}
+			if (avx2) {
+				return SimdLevel::Avx2;
+			}
+			return SimdLevel::Scalar;
+		}
+#endif
+	}
+
+	SimdLevel detectSimdLevel()
+	{
+#ifdef FE_SIMD_X86
+		static const SimdLevel level = detect();
+		return level;
+#else
+		return SimdLevel::Scalar;
+#endif
+	}
+
+	void calculateEscapeTimeBatch(std::span<const float> real, std::span<const float> imag, int maxIter,
+		std::span<int> iterations, std::span<float> zReal, std::span<float> zImag, std::span<int> periods)
+	{
+		calculateEscapeTimeBatch(detectSimdLevel(), real, imag, maxIter, iterations, zReal, zImag, periods);
+	}
+
+	void calculateEscapeTimeBatch(SimdLevel level, std::span<const float> real, std::span<const float> imag, int maxIter,
+		std::span<int> iterations, std::span<float> zReal, std::span<float> zImag, std::span<int> periods)
+	{
+		assert(real.size() == imag.size() && real.size() == iterations.size()
+			&& real.size() == zReal.size() && real.size() == zImag.size());
+		assert(periods.empty() || periods.size() == real.size());
+
+		// Never use an instruction set the cpu doesn't have
+		if (static_cast<int>(level) > static_cast<int>(detectSimdLevel())) {
+			level = detectSimdLevel();
+		}
+
+		// Points in the main cardioid and the period 2 bulb are answered right away.
+		// The rest are packed together so that the vectors stay full.
+		constexpr size_t chunkSize = 256;
+		float packedReal[chunkSize], packedImag[chunkSize], packedZr[chunkSize], packedZi[chunkSize];
+		int packedIterations[chunkSize], packedPeriods[chunkSize];
+		uint16_t packedIndices[chunkSize];
+
+		for (size_t start = 0; start < real.size(); start += chunkSize) {
+			const size_t count = std::min(chunkSize, real.size() - start);
+			size_t packed = 0;
+			for (size_t i = start; i < start + count; ++i) {
+				const int period = isInMainCardioid(real[i], imag[i]) ? 1 : isInPeriod2Bulb(real[i], imag[i]) ? 2 : 0;
+				if (period == 0) {
+					packedReal[packed] = real[i];
+					packedImag[packed] = imag[i];
+					packedIndices[packed++] = static_cast<uint16_t>(i - start);
+					continue;
+				}
+				iterations[i] = maxIter;
+				zReal[i] = real[i];
+				zImag[i] = imag[i];
+				if (!periods.empty()) {
+					periods[i] = period;
+				}
+			}
+
+			switch (level)
+			{
+#ifdef FE_SIMD_X86
+			case SimdLevel::Avx512:
+				escapeTimeAvx512(packedReal, packedImag, packed, maxIter, packedIterations, packedZr, packedZi, packedPeriods);
+				break;
+			case SimdLevel::Avx2:
+				escapeTimeAvx2(packedReal, packedImag, packed, maxIter, packedIterations, packedZr, packedZi, packedPeriods);
+				break;
+#endif
+			default:
+				escapeTimeScalar(packedReal, packedImag, packed, maxIter, packedIterations, packedZr, packedZi, packedPeriods);
+				break;
+			}
+
+			for (size_t j = 0; j < packed; ++j) {
+				const size_t i = start + packedIndices[j];
+				iterations[i] = packedIterations[j];
+				zReal[i] = packedZr[j];
+				zImag[i] = packedZi[j];
+				if (!periods.empty()) {
+					periods[i] = packedPeriods[j];
+				}
+			}
+		}
+	}
+
+	void calculateSmoothEscapeTimeBatch(std::span<const float> real, std::span<const float> imag, int maxIter, std::span<double> result)
+	{
+		assert(real.size() == imag.size() && real.size() == result.size());
+
+		// Work in fixed size chunks so that the temporaries fit on the stack
+		constexpr size_t chunkSize = 256;
+		int iterations[chunkSize];
+		float zReal[chunkSize];
+		float zImag[chunkSize];
+
+		for (size_t start = 0; start < real.size(); start += chunkSize) {
+			const size_t count = std::min(chunkSize, real.size() - start);
+			calculateEscapeTimeBatch(real.subspan(start, count), imag.subspan(start, count), maxIter,
+				{ iterations, count }, { zReal, count }, { zImag, count });
+
+			for (size_t i = 0; i < count; ++i) {
+				const double absZ = std::sqrt(static_cast<double>(zReal[i]) * zReal[i] + static_cast<double>(zImag[i]) * zImag[i]);
+				result[start + i] = smoothIterationCount(iterations[i], absZ, maxIter);
+			}
+		}
+	}
+}
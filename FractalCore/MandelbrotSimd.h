@@ -0,0 +1,41 @@
+#pragma once
+
+namespace mandelbrot {
+
+	enum class SimdLevel {
+		Scalar,
+		Avx2,
+		Avx512
+	};
+
+	// Best instruction set supported by both the cpu and the os. Detected once.
+	SimdLevel detectSimdLevel();
+
+	// Number of points a single instruction handles with the given level
+	constexpr int simdWidth(SimdLevel level) {
+		switch (level)
+		{
+		case SimdLevel::Avx2:
+			return 8;
+		case SimdLevel::Avx512:
+			return 16;
+		default:
+			return 1;
+		}
+	}
+
+	// Batched version of calculateEscapeTime. Point i is (real[i], imag[i]).
+	// Writes the iteration count, the final z and the orbit period (0 if none was found) of every point.
+	// All spans must have the same size, except that periods can be left empty if not needed.
+	// An orbit that converges slowly to its cycle may be reported with a multiple of its period.
+	void calculateEscapeTimeBatch(std::span<const float> real, std::span<const float> imag, int maxIter,
+		std::span<int> iterations, std::span<float> zReal, std::span<float> zImag, std::span<int> periods = {});
+
+	// Same as above but with an explicitly chosen instruction set, mainly for testing the different paths.
+	// Falls back to scalar if the level is not supported.
+	void calculateEscapeTimeBatch(SimdLevel level, std::span<const float> real, std::span<const float> imag, int maxIter,
+		std::span<int> iterations, std::span<float> zReal, std::span<float> zImag, std::span<int> periods = {});
+
+	// Batched version of calculateSmoothEscapeTime
+	void calculateSmoothEscapeTimeBatch(std::span<const float> real, std::span<const float> imag, int maxIter, std::span<double> result);
+}
@@ -0,0 +1,385 @@
+#include "pch.h"
+
+#include "MeshSnapshot.h"
+#include "Profiler.h"
+#include "Log.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+	// The arrays are used in place, so the file has to be in the byte order of the machine
+	static_assert(std::endian::native == std::endian::little, "Mesh snapshots are little endian");
+	static_assert(sizeof(glm::vec2) == 8 && sizeof(std::array<int, 3>) == 12 && sizeof(SnapshotQueueEntry) == 16);
+
+	constexpr char magic[8] = { 'F', 'E', 'M', 'E', 'S', 'H', 0, 0 };
+	constexpr size_t sectionAlignment = 64;
+
+	enum Section {
+		Positions,
+		EscapeTimes,
+		Distances,
+		Indices,
+		VertexReferences,
+		FreeEntries,
+		Costs,
+		Neighbors,
+		MergeQueue,
+		MergeBySize,
+		SectionCount
+	};
+
+	constexpr size_t elementSizes[SectionCount] = {
+		sizeof(glm::vec2), sizeof(float), sizeof(float), sizeof(uint32_t),
+		sizeof(int32_t), sizeof(uint32_t), sizeof(double), sizeof(std::array<int32_t, 3>),
+		sizeof(SnapshotQueueEntry), sizeof(SnapshotQueueEntry)
+	};
+
+	constexpr uint32_t stateComplete = 1;
+
+	struct SectionEntry {
+		uint64_t offset; // From the start of the file
+		uint64_t count; // Elements, not bytes
+	};
+
+	struct Header {
+		char magic[8];
+		uint32_t version;
+		uint32_t state;
+		double view[4]; // min x, min y, max x, max y
+		double scale;
+		double tooSmallScale;
+		int32_t maxIterations;
+		uint32_t sectionCount;
+		SectionEntry sections[SectionCount];
+	};
+	static_assert(std::is_trivially_copyable_v<Header>);
+
+	constexpr size_t alignUp(size_t value, size_t alignment) {
+		return (value + alignment - 1) / alignment * alignment;
+	}
+
+	// The mapping starts at a page boundary, which is enough alignment for everything in the file
+	const Header& headerOf(const MappedFile& file) {
+		return *reinterpret_cast<const Header*>(file.getData().data());
+	}
+
+	std::vector<std::byte> serialize(const MeshSnapshotData& data) {
+		const std::span<const std::byte> arrays[SectionCount] = {
+			std::as_bytes(std::span(data.positions)),
+			std::as_bytes(std::span(data.escapeTimes)),
+			std::as_bytes(std::span(data.distances)),
+			std::as_bytes(std::span(data.indices)),
+			std::as_bytes(std::span(data.vertexReferences)),
+			std::as_bytes(std::span(data.freeEntries)),
+			std::as_bytes(std::span(data.costs)),
+			std::as_bytes(std::span(data.neighbors)),
+			std::as_bytes(std::span(data.mergeQueue)),
+			std::as_bytes(std::span(data.mergeBySize)),
+		};
+
+		Header header{};
+		std::ranges::copy(magic, header.magic);
+		header.version = MeshSnapshot::version;
+		header.state = stateComplete;
+		header.view[0] = data.view.minPoint.x;
+		header.view[1] = data.view.minPoint.y;
+		header.view[2] = data.view.maxPoint.x;
+		header.view[3] = data.view.maxPoint.y;
+		header.scale = data.scale;
+		header.tooSmallScale = data.tooSmallScale;
+		header.maxIterations = data.maxIterations;
+		header.sectionCount = SectionCount;
+
+		size_t size = alignUp(sizeof(Header), sectionAlignment);
+		for (int i = 0; i < SectionCount; ++i) {
+			header.sections[i] = { size, arrays[i].size() / elementSizes[i] };
+			size = alignUp(size + arrays[i].size(), sectionAlignment);
+		}
+
+		std::vector<std::byte> image(size);
+		std::memcpy(image.data(), &header, sizeof(header));
+		for (int i = 0; i < SectionCount; ++i) {
+			std::ranges::copy(arrays[i], image.begin() + header.sections[i].offset);
+		}
+		return image;
+	}
+}
+
+std::optional<MappedFile> MappedFile::open(const std::string& path)
+{
+	MappedFile mapped;
+#ifdef _WIN32
+	mapped.m_file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+		nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (mapped.m_file == INVALID_HANDLE_VALUE) {
+		mapped.m_file = nullptr;
+		return std::nullopt;
+	}
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(mapped.m_file, &size) || size.QuadPart == 0) {
+		return std::nullopt;
+	}
+	mapped.m_mapping = CreateFileMappingA(mapped.m_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (!mapped.m_mapping) {
+		return std::nullopt;
+	}
+	mapped.m_data = static_cast<const std::byte*>(MapViewOfFile(mapped.m_mapping, FILE_MAP_READ, 0, 0, 0));
+	if (!mapped.m_data) {
+		return std::nullopt;
+	}
+	mapped.m_size = static_cast<size_t>(size.QuadPart);
+#else
+	const int file = ::open(path.c_str(), O_RDONLY);
+	if (file < 0) {
+		return std::nullopt;
+	}
+	struct stat status;
+	if (fstat(file, &status) != 0 || status.st_size == 0) {
+		::close(file);
+		return std::nullopt;
+	}
+	void* data = mmap(nullptr, static_cast<size_t>(status.st_size), PROT_READ, MAP_PRIVATE, file, 0);
+	// The mapping keeps the file open
+	::close(file);
+	if (data == MAP_FAILED) {
+		return std::nullopt;
+	}
+	mapped.m_data = static_cast<const std::byte*>(data);
+	mapped.m_size = static_cast<size_t>(status.st_size);
+#endif
+	return mapped;
+}
+
+MappedFile::MappedFile(MappedFile&& other) noexcept
+{
+	*this = std::move(other);
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept
+{
+	if (this != &other) {
+		close();
+		m_data = std::exchange(other.m_data, nullptr);
+		m_size = std::exchange(other.m_size, 0);
+#ifdef _WIN32
+		m_file = std::exchange(other.m_file, nullptr);
+		m_mapping = std::exchange(other.m_mapping, nullptr);
+#endif
+	}
+	return *this;
+}
+
+MappedFile::~MappedFile()
+{
+	close();
+}
+
+void MappedFile::close()
+{
+#ifdef _WIN32
+	if (m_data) {
+		UnmapViewOfFile(m_data);
+	}
+	if (m_mapping) {
+		CloseHandle(m_mapping);
+	}
+	if (m_file) {
+		CloseHandle(m_file);
+	}
+	m_file = nullptr;
+	m_mapping = nullptr;
+#else
+	if (m_data) {
+		munmap(const_cast<std::byte*>(m_data), m_size);
+	}
+#endif
+	m_data = nullptr;
+	m_size = 0;
+}
+
+std::optional<MeshSnapshot> MeshSnapshot::open(const std::string& path)
+{
+	auto file = MappedFile::open(path);
+	if (!file || file->getData().size() < sizeof(Header)) {
+		return std::nullopt;
+	}
+
+	const Header& header = headerOf(*file);
+	if (!std::ranges::equal(header.magic, magic) || header.version != version
+		|| header.state != stateComplete || header.sectionCount != SectionCount) {
+		return std::nullopt;
+	}
+	const size_t size = file->getData().size();
+	for (int i = 0; i < SectionCount; ++i) {
+		const SectionEntry& entry = header.sections[i];
+		if (entry.offset % sectionAlignment != 0 || entry.offset > size || entry.count > (size - entry.offset) / elementSizes[i]) {
+			return std::nullopt;
+		}
+	}
+
+	MeshSnapshot snapshot{ std::move(*file) };
+	if (!snapshot.isConsistent()) {
+		return std::nullopt;
+	}
+	return snapshot;
+}
+
+MeshSnapshot::MeshSnapshot(MappedFile file)
+	: m_file(std::move(file))
+{
+	const Header& header = headerOf(m_file);
+	m_view = geom::BBox2{
+		{ static_cast<float>(header.view[0]), static_cast<float>(header.view[1]) },
+		{ static_cast<float>(header.view[2]), static_cast<float>(header.view[3]) } };
+}
+
+double MeshSnapshot::getScale() const
+{
+	return headerOf(m_file).scale;
+}
+
+double MeshSnapshot::getTooSmallScale() const
+{
+	return headerOf(m_file).tooSmallScale;
+}
+
+int MeshSnapshot::getMaxIterations() const
+{
+	return headerOf(m_file).maxIterations;
+}
+
+std::span<const glm::vec2> MeshSnapshot::getPositions() const { return section<glm::vec2>(Positions); }
+std::span<const float> MeshSnapshot::getEscapeTimes() const { return section<float>(EscapeTimes); }
+std::span<const float> MeshSnapshot::getDistances() const { return section<float>(Distances); }
+std::span<const uint32_t> MeshSnapshot::getIndices() const { return section<uint32_t>(Indices); }
+std::span<const int> MeshSnapshot::getVertexReferences() const { return section<int>(VertexReferences); }
+std::span<const uint32_t> MeshSnapshot::getFreeEntries() const { return section<uint32_t>(FreeEntries); }
+std::span<const double> MeshSnapshot::getCosts() const { return section<double>(Costs); }
+std::span<const std::array<int, 3>> MeshSnapshot::getNeighbors() const { return section<std::array<int, 3>>(Neighbors); }
+std::span<const SnapshotQueueEntry> MeshSnapshot::getMergeQueue() const { return section<SnapshotQueueEntry>(MergeQueue); }
+std::span<const SnapshotQueueEntry> MeshSnapshot::getMergeBySize() const { return section<SnapshotQueueEntry>(MergeBySize); }
+
+template<typename T>
+std::span<const T> MeshSnapshot::section(int index) const
+{
+	const SectionEntry& entry = headerOf(m_file).sections[index];
+	return { reinterpret_cast<const T*>(m_file.getData().data() + entry.offset), static_cast<size_t>(entry.count) };
+}
+
+bool MeshSnapshot::isConsistent() const
+{
+	const size_t vertexCount = getPositions().size();
+	const size_t triangleCount = getIndices().size() / 3;
+	if (getEscapeTimes().size() != vertexCount || getDistances().size() != vertexCount
+		|| getVertexReferences().size() != vertexCount || getIndices().size() != triangleCount * 3
+		|| getCosts().size() != triangleCount || getNeighbors().size() != triangleCount) {
+		return false;
+	}
+	// Everything that is used as an index, so that a damaged file can't make the mesh read out of bounds
+	const auto isVertex = [&](uint32_t vertex) { return vertex < vertexCount; };
+	const auto isNeighbor = [&](const std::array<int, 3>& neighbors) {
+		return std::ranges::all_of(neighbors, [&](int neighbor) { return neighbor >= -1 && neighbor < static_cast<int>(triangleCount); });
+	};
+	// The merge queues hold every vertex at most once
+	const auto isQueue = [&](std::span<const SnapshotQueueEntry> queue) {
+		std::vector<bool> queued(vertexCount);
+		return std::ranges::all_of(queue, [&](const SnapshotQueueEntry& entry) {
+			if (!isVertex(entry.id) || queued[entry.id]) {
+				return false;
+			}
+			queued[entry.id] = true;
+			return true;
+		});
+	};
+	return std::ranges::all_of(getIndices(), isVertex) && std::ranges::all_of(getFreeEntries(), isVertex)
+		&& std::ranges::all_of(getNeighbors(), isNeighbor) && isQueue(getMergeQueue()) && isQueue(getMergeBySize());
+}
+
+MeshSnapshotWriter::MeshSnapshotWriter()
+	: m_thread(&MeshSnapshotWriter::run, this)
+{
+}
+
+MeshSnapshotWriter::~MeshSnapshotWriter()
+{
+	{
+		std::lock_guard lock(m_mutex);
+		m_stop = true;
+	}
+	m_wakeUp.notify_one();
+	m_thread.join();
+}
+
+void MeshSnapshotWriter::save(const std::string& path, MeshSnapshotData&& data)
+{
+	{
+		std::lock_guard lock(m_mutex);
+		const auto waiting = std::ranges::find(m_requests, path, &Request::path);
+		if (waiting != m_requests.end()) {
+			waiting->data = std::move(data);
+		}
+		else {
+			m_requests.push_back({ path, std::move(data) });
+		}
+	}
+	m_wakeUp.notify_one();
+}
+
+void MeshSnapshotWriter::flush()
+{
+	std::unique_lock lock(m_mutex);
+	m_idle.wait(lock, [&] { return m_requests.empty() && !m_writing; });
+}
+
+void MeshSnapshotWriter::run()
+{
+	while (true) {
+		Request request;
+		{
+			std::unique_lock lock(m_mutex);
+			m_wakeUp.wait(lock, [&] { return m_stop || !m_requests.empty(); });
+			// Stopping waits for the saves already asked for
+			if (m_requests.empty()) {
+				return;
+			}
+			request = std::move(m_requests.front());
+			m_requests.pop_front();
+			m_writing = true;
+		}
+
+		if (!write(request.path, serialize(request.data))) {
+			FE_LOG_ERROR("Failed to save mesh snapshot ", request.path);
+		}
+
+		{
+			std::lock_guard lock(m_mutex);
+			m_writing = false;
+		}
+		m_idle.notify_all();
+	}
+}
+
+bool MeshSnapshotWriter::write(const std::string& path, const std::vector<std::byte>& image)
+{
+	profiler::ScopedTimer timer{ "saveSnapshot" };
+	// Written next to the file and renamed over it, so the old snapshot stays whole until the new one is
+	const std::string temporary = path + ".tmp";
+	std::ofstream file{ temporary, std::ios::binary | std::ios::trunc };
+	file.write(reinterpret_cast<const char*>(image.data()), image.size());
+	file.close();
+	if (!file) {
+		return false;
+	}
+	std::error_code error;
+	std::filesystem::rename(temporary, path, error);
+	return !error;
+}
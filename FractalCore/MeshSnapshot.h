@@ -0,0 +1,129 @@
+#pragma once
+
+#include "utils.h"
+
+// Entry of a saved IndexedMaxHeap, with the padding spelled out so that the file has no undefined bytes
+struct SnapshotQueueEntry {
+	double key;
+	uint32_t id;
+	uint32_t padding = 0;
+};
+
+// Everything TriangleHandler needs to continue refining a mesh where it was left.
+// The arrays are the ones of TriangleHandler, freed vertices included.
+struct MeshSnapshotData {
+	geom::BBox2 view; // What was on the screen when saved
+	double scale = 0;
+	double tooSmallScale = 0;
+	int maxIterations = 0;
+
+	std::vector<glm::vec2> positions;
+	std::vector<float> escapeTimes;
+	std::vector<float> distances;
+	std::vector<uint32_t> indices;
+	std::vector<int> vertexReferences;
+	std::vector<uint32_t> freeEntries;
+	std::vector<double> costs;
+	std::vector<std::array<int, 3>> neighbors;
+	std::vector<SnapshotQueueEntry> mergeQueue;
+	std::vector<SnapshotQueueEntry> mergeBySize;
+};
+
+// Read only memory mapping of a whole file
+class MappedFile
+{
+public:
+	static std::optional<MappedFile> open(const std::string& path);
+
+	MappedFile(MappedFile&& other) noexcept;
+	MappedFile& operator=(MappedFile&& other) noexcept;
+	~MappedFile();
+
+	std::span<const std::byte> getData() const { return { m_data, m_size }; }
+
+private:
+	MappedFile() = default;
+	void close();
+
+	const std::byte* m_data = nullptr;
+	size_t m_size = 0;
+#ifdef _WIN32
+	void* m_file = nullptr;
+	void* m_mapping = nullptr;
+#endif
+};
+
+// A saved mesh read in place from a memory mapped file. Opening only checks the header and that the
+// arrays are consistent, the spans point straight into the mapping and stay valid as long as the snapshot.
+//
+// The file is little endian: a header with the parameters and the offset and length of every array,
+// then the arrays, each aligned to 64 bytes.
+class MeshSnapshot
+{
+public:
+	static constexpr uint32_t version = 1;
+
+	static std::optional<MeshSnapshot> open(const std::string& path);
+
+	const geom::BBox2& getView() const { return m_view; }
+	double getScale() const;
+	double getTooSmallScale() const;
+	int getMaxIterations() const;
+
+	std::span<const glm::vec2> getPositions() const;
+	std::span<const float> getEscapeTimes() const;
+	std::span<const float> getDistances() const;
+	std::span<const uint32_t> getIndices() const;
+	std::span<const int> getVertexReferences() const;
+	std::span<const uint32_t> getFreeEntries() const;
+	std::span<const double> getCosts() const;
+	std::span<const std::array<int, 3>> getNeighbors() const;
+	std::span<const SnapshotQueueEntry> getMergeQueue() const;
+	std::span<const SnapshotQueueEntry> getMergeBySize() const;
+
+private:
+	MeshSnapshot(MappedFile file);
+
+	template<typename T>
+	std::span<const T> section(int index) const;
+	bool isConsistent() const;
+
+	MappedFile m_file;
+	geom::BBox2 m_view;
+};
+
+// Saves snapshots on a thread of its own. Every save is written next to the file and renamed over it,
+// so a save that is cut short leaves the previous snapshot.
+class MeshSnapshotWriter
+{
+public:
+	MeshSnapshotWriter();
+	// Finishes the saves still waiting
+	~MeshSnapshotWriter();
+
+	MeshSnapshotWriter(const MeshSnapshotWriter&) = delete;
+	MeshSnapshotWriter& operator=(const MeshSnapshotWriter&) = delete;
+
+	// A save to the same path that hasn't started yet is replaced
+	void save(const std::string& path, MeshSnapshotData&& data);
+	// Waits until everything saved so far is written
+	void flush();
+
+private:
+	struct Request {
+		std::string path;
+		MeshSnapshotData data;
+	};
+
+	void run();
+	bool write(const std::string& path, const std::vector<std::byte>& image);
+
+	std::mutex m_mutex;
+	std::condition_variable m_wakeUp;
+	std::condition_variable m_idle;
+	std::deque<Request> m_requests;
+	bool m_writing = false;
+	bool m_stop = false;
+
+	std::thread m_thread; // Last so that everything else is initialized before the thread starts
+};
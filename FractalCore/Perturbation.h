@@ -0,0 +1,108 @@
+#pragma once
+
+#include "Mandelbrot.h"
+
+// Deep zoom rendering with perturbation theory.
+// One reference orbit Z is calculated with ReferenceType precision, every other sample
+// only iterates the difference d to the reference in double precision:
+//   d(n+1) = 2*Z(n)*d(n) + d(n)^2 + dc
+// ReferenceType needs +, -, * and conversions from and to double, numeric::DoubleDouble,
+// numeric::QuadDouble and numeric::FixedPoint from Precision.h work.
+namespace mandelbrot {
+
+	struct PerturbationResult {
+		int iterations;
+		std::complex<double> z;
+		bool glitched; // Pauldelbrot criterion, sample needs another reference
+	};
+
+	namespace perturbation {
+		constexpr double bailout = 16.0;
+
+		// |Z+d| smaller than this fraction of |Z| means that d has lost its precision
+		constexpr double glitchTolerance = 1e-3;
+	}
+
+	// 2 * a * b, types that square faster than they multiply overload this
+	template<typename T>
+	T twiceProduct(const T& a, const T& b, const T& /*aSquared*/, const T& /*bSquared*/) {
+		const T product = a * b;
+		return product + product;
+	}
+
+	template<typename ReferenceType>
+	struct HighPrecisionComplex {
+		ReferenceType real;
+		ReferenceType imag;
+	};
+
+	template<typename ReferenceType>
+	class ReferenceOrbit {
+	public:
+		ReferenceOrbit(HighPrecisionComplex<ReferenceType> c, int maxIter) : m_c(c) {
+			calculate(maxIter);
+		}
+
+		const HighPrecisionComplex<ReferenceType>& getC() const { return m_c; }
+
+		// Z(0) is always 0, Z(1) is c. Last value is either escaped or Z(maxIter + 1).
+		const std::vector<std::complex<double>>& getOrbit() const { return m_orbit; }
+
+		// Number of iterations before escaping, same as calculateEscapeTime of c
+		int getEscapeTime() const { return static_cast<int>(m_orbit.size()) - 2; }
+
+	private:
+		void calculate(int maxIter) {
+			m_orbit.clear();
+			m_orbit.reserve(maxIter + 2);
+			m_orbit.emplace_back(0.0, 0.0);
+
+			ReferenceType zr = m_c.real;
+			ReferenceType zi = m_c.imag;
+			for (int n = 0; n <= maxIter; ++n) {
+				const std::complex<double> z{ static_cast<double>(zr), static_cast<double>(zi) };
+				m_orbit.push_back(z);
+				if (std::norm(z) >= perturbation::bailout) {
+					break;
+				}
+				const ReferenceType zr2 = square(zr);
+				const ReferenceType zi2 = square(zi);
+				const ReferenceType zrzi2 = twiceProduct(zr, zi, zr2, zi2);
+				zr = zr2 - zi2 + m_c.real;
+				zi = zrzi2 + m_c.imag;
+			}
+		}
+
+		HighPrecisionComplex<ReferenceType> m_c;
+		std::vector<std::complex<double>> m_orbit;
+	};
+
+	// Escape time of reference.c + dc using the reference orbit.
+	// When the reference escapes, or |z| gets smaller than |d|, the orbit is rebased to Z(0) (Zhuoran).
+	// That handles most of the glitches, the rest are flagged with glitched.
+	inline PerturbationResult calculateEscapeTimePerturbed(const std::vector<std::complex<double>>& orbit, std::complex<double> dc, int maxIter) {
+		const size_t last = orbit.size() - 1;
+		size_t m = 1;
+		std::complex<double> d = dc;
+		int n = 0;
+		bool glitched = false;
+		while (n < maxIter) {
+			const std::complex<double> z = orbit[m] + d;
+			const double normZ = std::norm(z);
+			if (normZ >= perturbation::bailout) {
+				return { n, z, glitched };
+			}
+			if (normZ < perturbation::glitchTolerance * perturbation::glitchTolerance * std::norm(orbit[m])) {
+				glitched = true;
+			}
+			if (normZ < std::norm(d) || m == last) {
+				d = z;
+				m = 0;
+			}
+			d = 2.0 * orbit[m] * d + d * d + dc;
+			++m;
+			++n;
+		}
+		return { n, orbit[m] + d, glitched };
+	}
+}
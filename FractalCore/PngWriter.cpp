@@ -0,0 +1,236 @@
+#include "pch.h"
+
+#include "PngWriter.h"
+
+namespace {
+	constexpr size_t chunkSize = 1 << 20;
+	constexpr uint32_t bytesPerPixel = 3;
+
+	// Deflate allows matches of 3 to 258 bytes
+	constexpr uint32_t minRun = 3;
+	constexpr uint32_t maxRun = 258;
+
+	const std::array<uint32_t, 256> crcTable = [] {
+		std::array<uint32_t, 256> table{};
+		for (uint32_t n = 0; n < 256; ++n) {
+			uint32_t c = n;
+			for (int k = 0; k < 8; ++k) {
+				c = c & 1 ? 0xedb88320u ^ (c >> 1) : c >> 1;
+			}
+			table[n] = c;
+		}
+		return table;
+	}();
+
+	uint32_t updateCrc(uint32_t crc, std::span<const uint8_t> data) {
+		for (uint8_t byte : data) {
+			crc = crcTable[(crc ^ byte) & 0xff] ^ (crc >> 8);
+		}
+		return crc;
+	}
+
+	uint32_t updateAdler(uint32_t adler, std::span<const uint8_t> data) {
+		constexpr uint32_t modulo = 65521;
+		// The sums can't overflow in 5552 bytes
+		constexpr size_t block = 5552;
+		uint32_t a = adler & 0xffff;
+		uint32_t b = adler >> 16;
+		while (!data.empty()) {
+			const size_t count = std::min(block, data.size());
+			for (size_t i = 0; i < count; ++i) {
+				a += data[i];
+				b += a;
+			}
+			a %= modulo;
+			b %= modulo;
+			data = data.subspan(count);
+		}
+		return (b << 16) | a;
+	}
+
+	void appendBigEndian(std::vector<uint8_t>& out, uint32_t value) {
+		out.push_back(static_cast<uint8_t>(value >> 24));
+		out.push_back(static_cast<uint8_t>(value >> 16));
+		out.push_back(static_cast<uint8_t>(value >> 8));
+		out.push_back(static_cast<uint8_t>(value));
+	}
+
+	// Length codes 257-285 of deflate: first length of each code and its extra bits
+	constexpr uint16_t lengthBase[] = {
+		3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+		35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+	constexpr uint8_t lengthExtraBits[] = {
+		0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+		3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+}
+
+std::optional<PngWriter> PngWriter::create(const std::string& path, uint32_t width, uint32_t height)
+{
+	std::ofstream stream{ path, std::ios::binary };
+	if (!stream || width == 0 || height == 0) {
+		return std::nullopt;
+	}
+	return PngWriter(std::move(stream), width, height);
+}
+
+PngWriter::PngWriter(std::ofstream stream, uint32_t width, uint32_t height)
+	: m_stream(std::move(stream)), m_width(width), m_height(height)
+{
+	constexpr uint8_t signature[] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n' };
+	m_stream.write(reinterpret_cast<const char*>(signature), sizeof(signature));
+
+	std::vector<uint8_t> header;
+	appendBigEndian(header, width);
+	appendBigEndian(header, height);
+	header.push_back(8); // Bit depth
+	header.push_back(2); // RGB
+	header.push_back(0); // Deflate
+	header.push_back(0); // Adaptive filtering
+	header.push_back(0); // No interlace
+	writeChunk("IHDR", header);
+
+	m_filtered.resize(1 + static_cast<size_t>(width) * bytesPerPixel);
+	m_data.reserve(chunkSize + 1024);
+
+	// Zlib header for deflate with a 32k window. All the data goes to a single fixed Huffman block.
+	m_data.push_back(0x78);
+	m_data.push_back(0x01);
+	writeBits(0, 1);
+	writeBits(1, 2);
+}
+
+bool PngWriter::writeRows(std::span<const uint8_t> rows, uint32_t rowCount)
+{
+	const size_t rowSize = static_cast<size_t>(m_width) * bytesPerPixel;
+	assert(rows.size() >= rowCount * rowSize);
+	assert(m_rowsWritten + rowCount <= m_height);
+
+	for (uint32_t row = 0; row < rowCount; ++row) {
+		// The Sub filter turns runs of the same color into runs of zeros
+		const uint8_t* pixels = rows.data() + row * rowSize;
+		m_filtered[0] = 1;
+		for (size_t i = 0; i < rowSize; ++i) {
+			m_filtered[1 + i] = pixels[i] - (i >= bytesPerPixel ? pixels[i - bytesPerPixel] : 0);
+		}
+		m_adler = updateAdler(m_adler, m_filtered);
+
+		for (size_t i = 0; i < m_filtered.size();) {
+			const uint8_t value = m_filtered[i];
+			writeLiteral(value);
+			size_t run = 0;
+			while (i + 1 + run < m_filtered.size() && run < maxRun && m_filtered[i + 1 + run] == value) {
+				++run;
+			}
+			if (run >= minRun) {
+				writeRun(static_cast<uint32_t>(run));
+				i += 1 + run;
+			}
+			else {
+				++i;
+			}
+		}
+		flushData(false);
+	}
+	m_rowsWritten += rowCount;
+	return static_cast<bool>(m_stream);
+}
+
+bool PngWriter::finish()
+{
+	assert(m_rowsWritten == m_height);
+
+	// End of block, then the final block which is empty
+	writeHuffman(0, 7);
+	writeBits(1, 1);
+	writeBits(1, 2);
+	writeHuffman(0, 7);
+	alignToByte();
+	appendBigEndian(m_data, m_adler);
+	flushData(true);
+
+	writeChunk("IEND", {});
+	m_stream.close();
+	return !m_stream.fail();
+}
+
+void PngWriter::writeChunk(const char type[4], std::span<const uint8_t> data)
+{
+	std::vector<uint8_t> header;
+	appendBigEndian(header, static_cast<uint32_t>(data.size()));
+	header.insert(header.end(), type, type + 4);
+	m_stream.write(reinterpret_cast<const char*>(header.data()), header.size());
+	m_stream.write(reinterpret_cast<const char*>(data.data()), data.size());
+
+	uint32_t crc = updateCrc(0xffffffffu, std::span(header).subspan(4));
+	crc = updateCrc(crc, data) ^ 0xffffffffu;
+	std::vector<uint8_t> footer;
+	appendBigEndian(footer, crc);
+	m_stream.write(reinterpret_cast<const char*>(footer.data()), footer.size());
+}
+
+void PngWriter::flushData(bool force)
+{
+	if (m_data.size() >= chunkSize || (force && !m_data.empty())) {
+		writeChunk("IDAT", m_data);
+		m_data.clear();
+	}
+}
+
+void PngWriter::writeBits(uint32_t bits, int count)
+{
+	m_bitBuffer |= static_cast<uint64_t>(bits) << m_bitCount;
+	m_bitCount += count;
+	while (m_bitCount >= 8) {
+		m_data.push_back(static_cast<uint8_t>(m_bitBuffer));
+		m_bitBuffer >>= 8;
+		m_bitCount -= 8;
+	}
+}
+
+void PngWriter::writeHuffman(uint32_t code, int length)
+{
+	// Huffman codes go most significant bit first
+	uint32_t reversed = 0;
+	for (int i = 0; i < length; ++i) {
+		reversed |= ((code >> i) & 1) << (length - 1 - i);
+	}
+	writeBits(reversed, length);
+}
+
+void PngWriter::writeLiteral(uint8_t value)
+{
+	// Fixed Huffman codes of deflate
+	if (value < 144) {
+		writeHuffman(0x30 + value, 8);
+	}
+	else {
+		writeHuffman(0x190 + value - 144, 9);
+	}
+}
+
+void PngWriter::writeRun(uint32_t length)
+{
+	assert(length >= minRun && length <= maxRun);
+	int code = 0;
+	while (code + 1 < static_cast<int>(std::size(lengthBase)) && lengthBase[code + 1] <= length) {
+		++code;
+	}
+	const uint32_t symbol = 257 + code;
+	if (symbol < 280) {
+		writeHuffman(symbol - 256, 7);
+	}
+	else {
+		writeHuffman(0xc0 + symbol - 280, 8);
+	}
+	writeBits(length - lengthBase[code], lengthExtraBits[code]);
+
+	// Distance 1, repeat the previous byte
+	writeHuffman(0, 5);
+}
+
+void PngWriter::alignToByte()
+{
+	if (m_bitCount > 0) {
+		writeBits(0, 8 - m_bitCount);
+	}
+}
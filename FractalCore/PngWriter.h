@@ -0,0 +1,44 @@
+#pragma once
+
+// Writes an 8 bit RGB png a few rows at a time, so the whole image never has to be in memory.
+// The rows are compressed with run lengths only, which is fast and takes care of the large
+// single colored areas of fractal images.
+class PngWriter
+{
+public:
+	static std::optional<PngWriter> create(const std::string& path, uint32_t width, uint32_t height);
+
+	PngWriter(PngWriter&&) = default;
+	PngWriter& operator=(PngWriter&&) = default;
+
+	// 'rows' holds rowCount rows of width * 3 bytes
+	bool writeRows(std::span<const uint8_t> rows, uint32_t rowCount);
+	// Must be called after all the rows are written
+	bool finish();
+
+	uint32_t getRowsWritten() const { return m_rowsWritten; }
+
+private:
+	PngWriter(std::ofstream stream, uint32_t width, uint32_t height);
+
+	void writeChunk(const char type[4], std::span<const uint8_t> data);
+	void flushData(bool force);
+
+	// Deflate bit stream
+	void writeBits(uint32_t bits, int count);
+	void writeHuffman(uint32_t code, int length);
+	void writeLiteral(uint8_t value);
+	void writeRun(uint32_t length);
+	void alignToByte();
+
+	std::ofstream m_stream;
+	uint32_t m_width;
+	uint32_t m_height;
+	uint32_t m_rowsWritten = 0;
+
+	std::vector<uint8_t> m_filtered; // One row with the filter type byte
+	std::vector<uint8_t> m_data; // Compressed bytes not yet written as a chunk
+	uint64_t m_bitBuffer = 0;
+	int m_bitCount = 0;
+	uint32_t m_adler = 1;
+};
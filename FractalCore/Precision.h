@@ -0,0 +1,146 @@
+#pragma once
+
+#include "QuadDouble.h"
+#include "FixedPoint.h"
+
+namespace mandelbrot {
+
+	enum class Precision {
+		Float,
+		Double,
+		DoubleDouble,
+		QuadDouble
+	};
+
+	// Lowest precision that still tells apart points pixelSize apart. Rounding errors grow
+	// during the iteration and |c| goes up to 2, so a few bits of margin are kept.
+	inline Precision precisionForPixelSize(double pixelSize) {
+		constexpr double margin = 64;
+		if (pixelSize >= std::numeric_limits<float>::epsilon() * margin) {
+			return Precision::Float;
+		}
+		if (pixelSize >= std::numeric_limits<double>::epsilon() * margin) {
+			return Precision::Double;
+		}
+		if (pixelSize >= static_cast<double>(std::numeric_limits<numeric::DoubleDouble>::epsilon()) * margin) {
+			return Precision::DoubleDouble;
+		}
+		return Precision::QuadDouble;
+	}
+
+	// Calls function with a value of the numeric type of the precision
+	template<typename Function>
+	decltype(auto) withPrecision(Precision precision, Function&& function) {
+		switch (precision)
+		{
+		case Precision::Float:
+			return function(float{});
+		case Precision::Double:
+			return function(double{});
+		case Precision::DoubleDouble:
+			return function(numeric::DoubleDouble{});
+		default:
+			return function(numeric::QuadDouble{});
+		}
+	}
+
+	// Limb counts numeric::FixedPoint is instantiated with
+	constexpr std::array<int, 5> fixedPointLimbCounts{ 2, 4, 8, 16, 32 };
+
+	// Smallest limb count with bits fraction bits, at most the largest one of fixedPointLimbCounts
+	inline int fixedPointLimbsForBits(int bits) {
+		for (int limbs : fixedPointLimbCounts) {
+			if (numeric::FixedPoint<2>::integerBits + bits <= 64 * limbs) {
+				return limbs;
+			}
+		}
+		return fixedPointLimbCounts.back();
+	}
+
+	// Reference orbits need the bits of the pixel size and some more for the rounding errors
+	// that grow during long orbits
+	inline int fixedPointLimbsForPixelSize(double pixelSize) {
+		constexpr int marginBits = 64;
+		return fixedPointLimbsForBits(static_cast<int>(std::ceil(-std::log2(pixelSize))) + marginBits);
+	}
+
+	// Calls function with a numeric::FixedPoint of the limb count, which has to be one of fixedPointLimbCounts
+	template<typename Function>
+	decltype(auto) withFixedPoint(int limbs, Function&& function) {
+		switch (limbs)
+		{
+		case 2:
+			return function(numeric::FixedPoint<2>{});
+		case 4:
+			return function(numeric::FixedPoint<4>{});
+		case 8:
+			return function(numeric::FixedPoint<8>{});
+		case 16:
+			return function(numeric::FixedPoint<16>{});
+		default:
+			return function(numeric::FixedPoint<32>{});
+		}
+	}
+
+	// Parses numbers like "-0.75", "1e-40" or "-1.7400623825793399052208462530009e-1" into NumericType.
+	// Goes through NumericType arithmetic only, so all the digits the type can hold are kept.
+	template<typename NumericType>
+	std::optional<NumericType> parseDecimal(std::string_view text) {
+		size_t i = 0;
+		bool negative = false;
+		if (i < text.size() && (text[i] == '-' || text[i] == '+')) {
+			negative = text[i++] == '-';
+		}
+
+		NumericType mantissa = 0;
+		int exponent = 0;
+		bool hasDigits = false;
+		bool hasPoint = false;
+		for (; i < text.size(); ++i) {
+			const char ch = text[i];
+			if (ch >= '0' && ch <= '9') {
+				mantissa = mantissa * NumericType(10) + NumericType(ch - '0');
+				exponent -= hasPoint ? 1 : 0;
+				hasDigits = true;
+			}
+			else if (ch == '.' && !hasPoint) {
+				hasPoint = true;
+			}
+			else {
+				break;
+			}
+		}
+		if (!hasDigits) {
+			return std::nullopt;
+		}
+
+		if (i < text.size() && (text[i] == 'e' || text[i] == 'E')) {
+			++i;
+			if (i < text.size() && text[i] == '+') {
+				++i;
+			}
+			int written = 0;
+			const auto [end, error] = std::from_chars(text.data() + i, text.data() + text.size(), written);
+			if (error != std::errc{} || end == text.data() + i) {
+				return std::nullopt;
+			}
+			exponent += written;
+			i = end - text.data();
+		}
+		if (i != text.size()) {
+			return std::nullopt;
+		}
+
+		// 10^|exponent| by squaring, exact as long as the type can hold it
+		NumericType scale = 1;
+		NumericType power = 10;
+		for (unsigned e = static_cast<unsigned>(std::abs(exponent)); e != 0; e >>= 1) {
+			if (e & 1) {
+				scale = scale * power;
+			}
+			power = power * power;
+		}
+		const NumericType value = exponent < 0 ? mantissa / scale : mantissa * scale;
+		return negative ? -value : value;
+	}
+}
@@ -0,0 +1,165 @@
+#include "pch.h"
+
+#include "Profiler.h"
+
+namespace {
+	constexpr size_t eventsPerThread = 1 << 16;
+
+	struct Event {
+		std::atomic<const char*> name = nullptr;
+		std::atomic<uint64_t> start = 0;
+		std::atomic<uint64_t> end = 0;
+	};
+
+	// Written only by its own thread. A reader can meet an event that is being overwritten,
+	// which at worst shows up as one wrong event.
+	struct ThreadBuffer {
+		int thread = 0;
+		std::unique_ptr<Event[]> events = std::make_unique<Event[]>(eventsPerThread);
+		std::atomic<uint64_t> written = 0;
+	};
+
+	struct Registry {
+		std::mutex mutex;
+		std::vector<std::shared_ptr<ThreadBuffer>> buffers; // Kept after their threads exit
+		std::atomic<uint64_t> counters[static_cast<size_t>(profiler::Counter::Count)] = {};
+		uint64_t lastTotals = 0;
+
+		// Ticks are converted to time by how many have passed since these
+		uint64_t startTicks = profiler::readTimestamp();
+		std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+	};
+
+	Registry& registry()
+	{
+		static Registry registry;
+		return registry;
+	}
+
+	ThreadBuffer& threadBuffer()
+	{
+		thread_local const std::shared_ptr<ThreadBuffer> buffer = [] {
+			auto& registry = ::registry();
+			auto buffer = std::make_shared<ThreadBuffer>();
+			std::lock_guard lock(registry.mutex);
+			buffer->thread = static_cast<int>(registry.buffers.size());
+			registry.buffers.push_back(buffer);
+			return buffer;
+		}();
+		return *buffer;
+	}
+
+	double ticksPerSecond()
+	{
+		const auto& registry = ::registry();
+		const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - registry.startTime).count();
+		const uint64_t ticks = profiler::readTimestamp() - registry.startTicks;
+		return seconds > 0 && ticks > 0 ? ticks / seconds : 1e9;
+	}
+
+	// Calls function(thread, name, start, end) for every event still in the ring buffers
+	template<typename Function>
+	void forEachEvent(Function function)
+	{
+		auto& registry = ::registry();
+		std::vector<std::shared_ptr<ThreadBuffer>> buffers;
+		{
+			std::lock_guard lock(registry.mutex);
+			buffers = registry.buffers;
+		}
+		for (const auto& buffer : buffers) {
+			const uint64_t written = buffer->written.load(std::memory_order_acquire);
+			const uint64_t first = written > eventsPerThread ? written - eventsPerThread : 0;
+			for (uint64_t i = first; i < written; ++i) {
+				const Event& event = buffer->events[i % eventsPerThread];
+				function(buffer->thread, event.name.load(std::memory_order_relaxed),
+					event.start.load(std::memory_order_relaxed), event.end.load(std::memory_order_relaxed));
+			}
+		}
+	}
+}
+
+void profiler::record(const char* name, uint64_t start, uint64_t end)
+{
+	ThreadBuffer& buffer = threadBuffer();
+	const uint64_t index = buffer.written.load(std::memory_order_relaxed);
+	Event& event = buffer.events[index % eventsPerThread];
+	event.name.store(name, std::memory_order_relaxed);
+	event.start.store(start, std::memory_order_relaxed);
+	event.end.store(end, std::memory_order_relaxed);
+	buffer.written.store(index + 1, std::memory_order_release);
+}
+
+void profiler::add(Counter counter, uint64_t amount)
+{
+	registry().counters[static_cast<size_t>(counter)].fetch_add(amount, std::memory_order_relaxed);
+}
+
+uint64_t profiler::get(Counter counter)
+{
+	return registry().counters[static_cast<size_t>(counter)].load(std::memory_order_relaxed);
+}
+
+std::vector<profiler::ScopeTotal> profiler::takeTotals()
+{
+	auto& registry = ::registry();
+	const uint64_t from = registry.lastTotals;
+	const uint64_t to = readTimestamp();
+	registry.lastTotals = to;
+
+	std::vector<ScopeTotal> totals;
+	std::vector<uint64_t> ticks;
+	forEachEvent([&](int, const char* name, uint64_t start, uint64_t end) {
+		if (end <= from || end > to || end < start) {
+			return;
+		}
+		// Few distinct names, the ones in the same scope always have the same pointer
+		auto total = std::ranges::find(totals, name, &ScopeTotal::name);
+		if (total == totals.end()) {
+			totals.push_back({ name, 0, 0 });
+			ticks.push_back(0);
+			total = totals.end() - 1;
+		}
+		total->calls++;
+		ticks[total - totals.begin()] += end - start;
+	});
+
+	const double tps = ticksPerSecond();
+	for (size_t i = 0; i < totals.size(); ++i) {
+		totals[i].seconds = ticks[i] / tps;
+	}
+	return totals;
+}
+
+bool profiler::writeChromeTrace(const std::string& path)
+{
+	std::ofstream file(path);
+	if (!file) {
+		return false;
+	}
+
+	const auto& registry = ::registry();
+	const double microsecondsPerTick = 1e6 / ticksPerSecond();
+	const auto toMicroseconds = [&](uint64_t ticks) {
+		return (static_cast<double>(ticks) - static_cast<double>(registry.startTicks)) * microsecondsPerTick;
+	};
+
+	file << "{\"traceEvents\":[\n";
+	file.precision(3);
+	file << std::fixed;
+	forEachEvent([&](int thread, const char* name, uint64_t start, uint64_t end) {
+		if (!name || end < start) {
+			return;
+		}
+		file << "{\"name\":\"" << name << "\",\"ph\":\"X\",\"pid\":0,\"tid\":" << thread
+			<< ",\"ts\":" << toMicroseconds(start) << ",\"dur\":" << (end - start) * microsecondsPerTick << "},\n";
+	});
+
+	file << "{\"name\":\"counters\",\"ph\":\"C\",\"pid\":0,\"tid\":0,\"ts\":" << toMicroseconds(readTimestamp()) << ",\"args\":{"
+		<< "\"samples\":" << get(Counter::Samples)
+		<< ",\"iterations\":" << get(Counter::Iterations)
+		<< ",\"cacheHits\":" << get(Counter::CacheHits)
+		<< ",\"cacheMisses\":" << get(Counter::CacheMisses) << "}}\n";
+	file << "]}\n";
+	return static_cast<bool>(file);
+}
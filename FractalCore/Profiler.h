@@ -0,0 +1,66 @@
+#pragma once
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define FE_PROFILER_TSC
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <x86intrin.h>
+#endif
+#endif
+
+// Low overhead timers and counters. Every thread records into its own ring buffer, so timing a
+// scope is a few stores. The newest events can be summed for the stats line or exported as a
+// Chrome trace (chrome://tracing or ui.perfetto.dev).
+namespace profiler {
+
+	// Time stamp counter ticks, converted to time only when the events are read
+	inline uint64_t readTimestamp() {
+#ifdef FE_PROFILER_TSC
+		return __rdtsc();
+#else
+		return static_cast<uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count());
+#endif
+	}
+
+	// 'name' must outlive the profiler, string literals are meant
+	void record(const char* name, uint64_t start, uint64_t end);
+
+	class ScopedTimer
+	{
+	public:
+		explicit ScopedTimer(const char* name) : m_name(name), m_start(readTimestamp()) {}
+		~ScopedTimer() { record(m_name, m_start, readTimestamp()); }
+
+		ScopedTimer(const ScopedTimer&) = delete;
+		ScopedTimer& operator=(const ScopedTimer&) = delete;
+
+	private:
+		const char* m_name;
+		uint64_t m_start;
+	};
+
+	enum class Counter {
+		Samples, // Escape times asked for
+		Iterations, // Iterations calculated for the samples that were not cached
+		CacheHits,
+		CacheMisses,
+		Count
+	};
+
+	void add(Counter counter, uint64_t amount);
+	uint64_t get(Counter counter);
+
+	struct ScopeTotal {
+		const char* name;
+		int calls;
+		double seconds;
+	};
+
+	// Time spent in each scope since the previous call, on all threads together.
+	// Only the events still in the ring buffers are seen.
+	std::vector<ScopeTotal> takeTotals();
+
+	// The events of all threads and the counters as a Chrome trace. Returns false if the file can't be written.
+	bool writeChromeTrace(const std::string& path);
+}
@@ -0,0 +1,182 @@
+#pragma once
+
+#include "DoubleDouble.h"
+
+namespace numeric {
+
+	namespace detail {
+		// a + b + c to a + b (+ c)
+		inline void threeSum(double& a, double& b, double& c) {
+			double t2, t3;
+			const double t1 = twoSum(a, b, t2);
+			a = twoSum(c, t1, t3);
+			b = twoSum(t2, t3, c);
+		}
+
+		// Same as threeSum but the smallest part is dropped
+		inline void threeSum2(double& a, double& b, double c) {
+			double t2, t3;
+			const double t1 = twoSum(a, b, t2);
+			a = twoSum(c, t1, t3);
+			b = t2 + t3;
+		}
+	}
+
+	// About 212 bits of mantissa, the exponent range of double
+	struct QuadDouble {
+		double x[4] = {};
+
+		constexpr QuadDouble() = default;
+		constexpr QuadDouble(double value) : x{ value, 0.0, 0.0, 0.0 } {}
+		constexpr QuadDouble(const DoubleDouble& value) : x{ value.hi, value.lo, 0.0, 0.0 } {}
+		constexpr QuadDouble(double x0, double x1, double x2, double x3) : x{ x0, x1, x2, x3 } {}
+
+		explicit constexpr operator double() const { return x[0]; }
+		explicit constexpr operator DoubleDouble() const { return { x[0], x[1] }; }
+
+		// Sum of five overlapping parts to four non overlapping ones. Two sweeps without the
+		// zero checks of the reference implementation, that only affects exact cancellation.
+		static QuadDouble renormalize(double c0, double c1, double c2, double c3, double c4) {
+			double e0, e1, e2, e3;
+			double s = detail::twoSum(c3, c4, e3);
+			s = detail::twoSum(c2, s, e2);
+			s = detail::twoSum(c1, s, e1);
+			const double r0 = detail::twoSum(c0, s, e0);
+
+			double t;
+			const double r1 = detail::twoSum(e0, e1, t);
+			const double r2 = detail::twoSum(t, e2, t);
+			const double r3 = t + e3;
+			double f0, f1, f2;
+			const double q0 = detail::quickTwoSum(r0, r1, f0);
+			const double q1 = detail::twoSum(f0, r2, f1);
+			const double q2 = detail::twoSum(f1, r3, f2);
+			return { q0, q1, q2, f2 };
+		}
+
+		friend QuadDouble operator+(const QuadDouble& a, const QuadDouble& b) {
+			double t0, t1, t2, t3;
+			const double s0 = detail::twoSum(a.x[0], b.x[0], t0);
+			double s1 = detail::twoSum(a.x[1], b.x[1], t1);
+			double s2 = detail::twoSum(a.x[2], b.x[2], t2);
+			double s3 = detail::twoSum(a.x[3], b.x[3], t3);
+
+			s1 = detail::twoSum(s1, t0, t0);
+			detail::threeSum(s2, t0, t1);
+			detail::threeSum2(s3, t0, t2);
+			t0 = t0 + t1 + t3;
+			return renormalize(s0, s1, s2, s3, t0);
+		}
+
+		friend constexpr QuadDouble operator-(const QuadDouble& a) {
+			return { -a.x[0], -a.x[1], -a.x[2], -a.x[3] };
+		}
+
+		friend QuadDouble operator-(const QuadDouble& a, const QuadDouble& b) {
+			return a + -b;
+		}
+
+		friend QuadDouble operator*(const QuadDouble& a, const QuadDouble& b) {
+			double q0, q1, q2, q3, q4, q5, t0, t1;
+			const double p0 = detail::twoProd(a.x[0], b.x[0], q0);
+			double p1 = detail::twoProd(a.x[0], b.x[1], q1);
+			double p2 = detail::twoProd(a.x[1], b.x[0], q2);
+			double p3 = detail::twoProd(a.x[0], b.x[2], q3);
+			double p4 = detail::twoProd(a.x[1], b.x[1], q4);
+			double p5 = detail::twoProd(a.x[2], b.x[0], q5);
+
+			detail::threeSum(p1, p2, q0);
+
+			// (p2, q1, q2) + (p3, p4, p5)
+			detail::threeSum(p2, q1, q2);
+			detail::threeSum(p3, p4, p5);
+			const double s0 = detail::twoSum(p2, p3, t0);
+			double s1 = detail::twoSum(q1, p4, t1);
+			double s2 = q2 + p5;
+			s1 = detail::twoSum(s1, t0, t0);
+			s2 += t0 + t1;
+
+			// Terms of the order eps^3
+			s1 += a.x[0] * b.x[3] + a.x[1] * b.x[2] + a.x[2] * b.x[1] + a.x[3] * b.x[0] + q0 + q3 + q4 + q5;
+			return renormalize(p0, p1, s0, s1, s2);
+		}
+
+		friend QuadDouble operator/(const QuadDouble& a, const QuadDouble& b) {
+			// Long division, one double of the quotient at a time
+			const double q0 = a.x[0] / b.x[0];
+			QuadDouble r = a - b * q0;
+			const double q1 = r.x[0] / b.x[0];
+			r = r - b * q1;
+			const double q2 = r.x[0] / b.x[0];
+			r = r - b * q2;
+			const double q3 = r.x[0] / b.x[0];
+			r = r - b * q3;
+			const double q4 = r.x[0] / b.x[0];
+			return renormalize(q0, q1, q2, q3, q4);
+		}
+
+		QuadDouble& operator+=(const QuadDouble& other) { return *this = *this + other; }
+		QuadDouble& operator-=(const QuadDouble& other) { return *this = *this - other; }
+		QuadDouble& operator*=(const QuadDouble& other) { return *this = *this * other; }
+		QuadDouble& operator/=(const QuadDouble& other) { return *this = *this / other; }
+
+		friend constexpr bool operator==(const QuadDouble& a, const QuadDouble& b) {
+			return a.x[0] == b.x[0] && a.x[1] == b.x[1] && a.x[2] == b.x[2] && a.x[3] == b.x[3];
+		}
+
+		friend constexpr std::partial_ordering operator<=>(const QuadDouble& a, const QuadDouble& b) {
+			for (int i = 0; i < 3; ++i) {
+				if (a.x[i] != b.x[i]) {
+					return a.x[i] <=> b.x[i];
+				}
+			}
+			return a.x[3] <=> b.x[3];
+		}
+	};
+
+	// Cheaper than a * a, the symmetric products are only calculated once
+	inline QuadDouble square(const QuadDouble& a) {
+		double q0, q1, q2, q3, t0, t1;
+		const double p0 = detail::twoSquare(a.x[0], q0);
+		double p1 = detail::twoProd(2.0 * a.x[0], a.x[1], q1);
+		double p2 = detail::twoProd(2.0 * a.x[0], a.x[2], q2);
+		double p3 = detail::twoSquare(a.x[1], q3);
+
+		p1 = detail::twoSum(q0, p1, q0);
+		q0 = detail::twoSum(q0, q1, q1);
+		p2 = detail::twoSum(p2, p3, p3);
+
+		const double s0 = detail::twoSum(q0, p2, t0);
+		double s1 = detail::twoSum(q1, p3, t1);
+		s1 = detail::twoSum(s1, t0, t0);
+		t0 += t1;
+
+		s1 = detail::quickTwoSum(s1, t0, t0);
+		p2 = detail::quickTwoSum(s0, s1, t1);
+		p3 = detail::quickTwoSum(t1, t0, q0);
+
+		double p4 = 2.0 * a.x[0] * a.x[3];
+		double p5 = 2.0 * a.x[1] * a.x[2];
+		p4 = detail::twoSum(p4, p5, p5);
+		q2 = detail::twoSum(q2, q3, q3);
+
+		t0 = detail::twoSum(p4, q2, t1);
+		t1 = t1 + p5 + q3;
+
+		p3 = detail::twoSum(p3, t0, p4);
+		p4 = p4 + q0 + t1;
+		return QuadDouble::renormalize(p0, p1, p2, p3, p4);
+	}
+
+	inline QuadDouble abs(const QuadDouble& a) {
+		return a.x[0] < 0.0 ? -a : a;
+	}
+}
+
+template<>
+class std::numeric_limits<numeric::QuadDouble> : public std::numeric_limits<double> {
+public:
+	static constexpr int digits = 209;
+	static constexpr int digits10 = 62;
+	static constexpr numeric::QuadDouble epsilon() { return 0x1p-209; }
+};
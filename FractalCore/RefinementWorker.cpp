@@ -0,0 +1,195 @@
+#include "pch.h"
+
+#include "RefinementWorker.h"
+#include "HistogramColoring.h"
+#include "Profiler.h"
+#include "Log.h"
+
+namespace {
+	constexpr int maxToRemove = 2000;
+	constexpr int maxToMerge = 2000;
+	constexpr int refineBatch = 50;
+
+	// How long to sleep when there was nothing to refine and the view didn't change
+	constexpr auto idleWait = std::chrono::milliseconds(20);
+
+	// The colors adapt to the histogram gradually anyway, collecting it with every update would be wasted
+	constexpr auto histogramInterval = std::chrono::milliseconds(50);
+
+	// element(i) gives the i:th element of the source
+	template<typename T, typename Element>
+	void copyRanges(size_t sourceSize, Element element, DirtyRanges& ranges, std::vector<DirtyRanges::Range>& rangesOut, std::vector<T>& out)
+	{
+		ranges.clip(sourceSize);
+		rangesOut = ranges.getRanges();
+		out.clear();
+		for (const auto& range : rangesOut) {
+			for (size_t i = range.begin; i < range.end; ++i) {
+				out.push_back(element(i));
+			}
+		}
+	}
+}
+
+RefinementWorker::RefinementWorker(const VertexGenerator& vgen, std::chrono::milliseconds budget)
+	: m_triangleHandler(vgen), m_budget(budget), m_thread(&RefinementWorker::run, this)
+{
+}
+
+RefinementWorker::~RefinementWorker()
+{
+	{
+		std::lock_guard lock(m_mutex);
+		m_stop = true;
+	}
+	m_wakeUp.notify_one();
+	m_thread.join();
+}
+
+void RefinementWorker::setView(const geom::BBox2& screenBb)
+{
+	{
+		std::lock_guard lock(m_mutex);
+		m_view = screenBb;
+		m_hasView = true;
+		m_viewChanged = true;
+	}
+	m_wakeUp.notify_one();
+}
+
+bool RefinementWorker::takeUpdate(MeshUpdate& update)
+{
+	std::lock_guard lock(m_mutex);
+	if (!m_hasReady) {
+		return false;
+	}
+	std::swap(update, m_ready);
+	m_hasReady = false;
+	return true;
+}
+
+void RefinementWorker::saveSnapshot(const std::string& path)
+{
+	{
+		std::lock_guard lock(m_mutex);
+		m_snapshotsToSave.push_back(path);
+	}
+	m_wakeUp.notify_one();
+}
+
+void RefinementWorker::loadSnapshot(MeshSnapshot snapshot)
+{
+	{
+		std::lock_guard lock(m_mutex);
+		m_snapshotToLoad = std::move(snapshot);
+	}
+	m_wakeUp.notify_one();
+}
+
+void RefinementWorker::run()
+{
+	while (true) {
+		geom::BBox2 view;
+		{
+			std::unique_lock lock(m_mutex);
+			m_wakeUp.wait(lock, [&] { return m_stop || m_hasView; });
+			if (m_stop) {
+				return;
+			}
+			view = m_view;
+			m_viewChanged = false;
+		}
+
+		// Refine until the budget is used, then let the render thread have the result
+		const auto start = std::chrono::steady_clock::now();
+		int changes = handleSnapshots(view) ? 1 : 0;
+		changes += m_triangleHandler.removeTrianglesOutsideScreen(view, maxToRemove);
+		changes += m_triangleHandler.mergeTriangles(view, maxToMerge);
+		while (std::chrono::steady_clock::now() - start < m_budget) {
+			const int divided = m_triangleHandler.generateVertices(view, refineBatch);
+			if (divided == 0) {
+				break;
+			}
+			changes += divided;
+		}
+
+		if (changes > 0 || m_epoch == 0) {
+			publish(view);
+		}
+		else {
+			std::unique_lock lock(m_mutex);
+			m_wakeUp.wait_for(lock, idleWait, [&] {
+				return m_stop || m_viewChanged || !m_snapshotsToSave.empty() || m_snapshotToLoad.has_value();
+			});
+		}
+	}
+}
+
+bool RefinementWorker::handleSnapshots(geom::BBox2& view)
+{
+	std::vector<std::string> toSave;
+	std::optional<MeshSnapshot> toLoad;
+	{
+		std::lock_guard lock(m_mutex);
+		std::swap(toSave, m_snapshotsToSave);
+		std::swap(toLoad, m_snapshotToLoad);
+	}
+
+	// Saved before loading, a save asked for first is of the mesh that was there
+	for (const std::string& path : toSave) {
+		MeshSnapshotData data;
+		m_triangleHandler.snapshot(view, data);
+		m_snapshotWriter.save(path, std::move(data));
+	}
+	if (!toLoad) {
+		return false;
+	}
+	if (!m_triangleHandler.restore(*toLoad)) {
+		FE_LOG_ERROR("Mesh snapshot was made with other limits, not loaded");
+		return false;
+	}
+	// The view may not have caught up yet, refining for the old one would throw the loaded mesh away
+	view = toLoad->getView();
+	return true;
+}
+
+void RefinementWorker::publish(const geom::BBox2& view)
+{
+	profiler::ScopedTimer timer{ "publish" };
+	// An update that wasn't taken yet gets replaced, so its changes have to be sent again.
+	// If it gets taken meanwhile they are just written twice.
+	bool previousTaken;
+	{
+		std::lock_guard lock(m_mutex);
+		previousTaken = !m_hasReady;
+	}
+	if (previousTaken) {
+		m_pendingVertices.clear();
+		m_pendingIndices.clear();
+	}
+	m_triangleHandler.takeDirtyRanges(m_pendingVertices, m_pendingIndices);
+
+	// The mesh keeps positions and escape times apart, the vertex buffer has them interleaved
+	const auto& positions = m_triangleHandler.getPositions();
+	const auto& escapeTimes = m_triangleHandler.getEscapeTimes();
+	const auto& indices = m_triangleHandler.getIndeices();
+	m_building.vertexCount = positions.size();
+	m_building.indexCount = indices.size();
+	copyRanges(positions.size(), [&](size_t i) { return Vertex{ positions[i], escapeTimes[i] }; },
+		m_pendingVertices, m_building.vertexRanges, m_building.vertices);
+	copyRanges(indices.size(), [&](size_t i) { return indices[i]; },
+		m_pendingIndices, m_building.indexRanges, m_building.indices);
+	const auto now = std::chrono::steady_clock::now();
+	if (m_collectHistogram && now - m_lastHistogram >= histogramInterval) {
+		HistogramColoring::collect(positions, escapeTimes, indices, view, constants::maxIterations, m_building.histogram);
+		m_lastHistogram = now;
+	}
+	else {
+		m_building.histogram.clear();
+	}
+	m_building.epoch = ++m_epoch;
+
+	std::lock_guard lock(m_mutex);
+	std::swap(m_building, m_ready);
+	m_hasReady = true;
+}
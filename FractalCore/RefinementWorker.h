@@ -0,0 +1,76 @@
+#pragma once
+
+#include "TriangleHandler.h"
+
+// Changes to the mesh handed from the refinement thread to the render thread.
+// Only the changed ranges are copied, their contents are stored back to back in 'vertices' and 'indices'.
+struct MeshUpdate {
+	size_t vertexCount = 0;
+	size_t indexCount = 0;
+	std::vector<DirtyRanges::Range> vertexRanges;
+	std::vector<DirtyRanges::Range> indexRanges;
+	std::vector<Vertex> vertices;
+	std::vector<uint32_t> indices;
+	std::vector<double> histogram; // HistogramColoring::collect of the view, empty if not asked for or not due yet
+	uint64_t epoch = 0; // Increases with every published update
+};
+
+// Runs the mesh refinement on a background thread so that slow escape time evaluation
+// never blocks the render loop. The worker refines towards the latest view and publishes
+// an update at least once every time budget.
+class RefinementWorker
+{
+public:
+	RefinementWorker(const VertexGenerator& vgen, std::chrono::milliseconds budget = std::chrono::milliseconds(8));
+	~RefinementWorker();
+
+	RefinementWorker(const RefinementWorker&) = delete;
+	RefinementWorker& operator=(const RefinementWorker&) = delete;
+
+	void setView(const geom::BBox2& screenBb);
+	// Whether the updates come with a histogram of escape times for HistogramColoring
+	void setCollectHistogram(bool collect) { m_collectHistogram = collect; }
+
+	// Swaps the newest published update into 'update'. Returns false if nothing new was published.
+	// The update contains all changes since the previously taken one.
+	// The old content of 'update' is reused by the worker, so keep passing the same object.
+	bool takeUpdate(MeshUpdate& update);
+
+	// The mesh as it is when the worker gets to it is saved in the background
+	void saveSnapshot(const std::string& path);
+	// The worker continues from the snapshot, the next update replaces the whole mesh
+	void loadSnapshot(MeshSnapshot snapshot);
+
+private:
+	void run();
+	void publish(const geom::BBox2& view);
+	// Returns whether the mesh was replaced, 'view' is then the one of the snapshot
+	bool handleSnapshots(geom::BBox2& view);
+
+	TriangleHandler m_triangleHandler;
+	std::chrono::milliseconds m_budget;
+
+	std::mutex m_mutex;
+	std::condition_variable m_wakeUp;
+	geom::BBox2 m_view;
+	bool m_hasView = false;
+	bool m_viewChanged = false;
+	bool m_stop = false;
+	std::atomic<bool> m_collectHistogram = false;
+	std::vector<std::string> m_snapshotsToSave;
+	std::optional<MeshSnapshot> m_snapshotToLoad;
+
+	MeshUpdate m_building; // Only touched by the worker
+	MeshUpdate m_ready; // Guarded by m_mutex
+	bool m_hasReady = false;
+	uint64_t m_epoch = 0;
+	std::chrono::steady_clock::time_point m_lastHistogram;
+
+	// Changed since the render thread last took an update
+	DirtyRanges m_pendingVertices;
+	DirtyRanges m_pendingIndices;
+
+	MeshSnapshotWriter m_snapshotWriter;
+
+	std::thread m_thread; // Last so that everything else is initialized before the thread starts
+};
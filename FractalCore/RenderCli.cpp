@@ -0,0 +1,91 @@
+#include "pch.h"
+
+#include "RenderCli.h"
+#include "TileRenderer.h"
+
+namespace {
+	void printUsage(const char* program)
+	{
+		std::cout << "Usage: " << program << " --render <output.png> [options]\n"
+			<< "  --center <real> <imag>   Center of the view, up to 600 digits (default -0.5 0)\n"
+			<< "  --width <value>          Width of the view in the complex plane (default 3)\n"
+			<< "  --size <width> <height>  Image size in pixels (default 1920 1080)\n"
+			<< "  --iterations <count>     Maximum iterations (default 300)\n"
+			<< "  --strip <rows>           Rows rendered at a time (default 64)\n"
+			<< "  --formula <name>         mandelbrot, or multibrot, burning-ship, tricorn or julia with\n"
+			<< "                           an optional :<exponent> of 2 to 8, for example multibrot:3\n"
+			<< "  --julia <real> <imag>    Constant of the julia formula (default -0.8 0.156)\n";
+	}
+}
+
+int runRenderCli(int argc, char** argv)
+{
+	RenderSettings settings;
+	std::string output;
+
+	// Every option takes a fixed number of values
+	const auto hasValues = [&](int i, int count) { return i + count < argc; };
+	try {
+		for (int i = 1; i < argc; ++i) {
+			const std::string option = argv[i];
+			if (option == "--render" && hasValues(i, 1)) {
+				output = argv[++i];
+			}
+			else if (option == "--center" && hasValues(i, 2)) {
+				const auto real = RenderSettings::Coordinate::fromDecimal(argv[++i]);
+				const auto imag = RenderSettings::Coordinate::fromDecimal(argv[++i]);
+				if (!real || !imag) {
+					printUsage(argv[0]);
+					return 1;
+				}
+				settings.centerReal = *real;
+				settings.centerImag = *imag;
+			}
+			else if (option == "--width" && hasValues(i, 1)) {
+				settings.width = std::stod(argv[++i]);
+			}
+			else if (option == "--size" && hasValues(i, 2)) {
+				settings.imageWidth = static_cast<uint32_t>(std::stoul(argv[++i]));
+				settings.imageHeight = static_cast<uint32_t>(std::stoul(argv[++i]));
+			}
+			else if (option == "--iterations" && hasValues(i, 1)) {
+				settings.maxIterations = std::stoi(argv[++i]);
+			}
+			else if (option == "--strip" && hasValues(i, 1)) {
+				settings.stripHeight = static_cast<uint32_t>(std::stoul(argv[++i]));
+			}
+			else if (option == "--formula" && hasValues(i, 1)) {
+				const auto formula = mandelbrot::parseFormula(argv[++i]);
+				if (!formula) {
+					printUsage(argv[0]);
+					return 1;
+				}
+				settings.formula = *formula;
+			}
+			else if (option == "--julia" && hasValues(i, 2)) {
+				const double real = std::stod(argv[++i]);
+				const double imag = std::stod(argv[++i]);
+				settings.juliaConstant = { real, imag };
+			}
+			else {
+				printUsage(argv[0]);
+				return 1;
+			}
+		}
+	}
+	catch (const std::exception&) {
+		printUsage(argv[0]);
+		return 1;
+	}
+
+	if (output.empty() || settings.imageWidth == 0 || settings.imageHeight == 0 || settings.width <= 0) {
+		printUsage(argv[0]);
+		return 1;
+	}
+
+	if (!renderToPng(settings, output, std::cout)) {
+		std::cout << "Writing " << output << " failed" << std::endl;
+		return 1;
+	}
+	return 0;
+}
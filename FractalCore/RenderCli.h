@@ -0,0 +1,5 @@
+#pragma once
+
+// Headless rendering from the command line, for machines without a gpu.
+// Returns the process exit code.
+int runRenderCli(int argc, char** argv);
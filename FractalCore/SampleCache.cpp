@@ -0,0 +1,160 @@
+#include "pch.h"
+
+#include "SampleCache.h"
+
+namespace {
+	// Beyond this the lattice coordinates don't fit into 64 bits
+	constexpr int maxLevel = 60;
+	constexpr float maxCoordinate = 2.0f;
+
+	// Smallest level at which value * 2^level is an integer
+	int latticeLevel(float value) {
+		if (value == 0.0f) {
+			return 0;
+		}
+		int exponent;
+		const float mantissa = std::frexp(value, &exponent);
+		const auto bits = static_cast<uint32_t>(std::abs(std::ldexp(mantissa, std::numeric_limits<float>::digits)));
+		return std::numeric_limits<float>::digits - exponent - std::countr_zero(bits);
+	}
+
+	uint64_t mix(uint64_t value) {
+		// splitmix64 finalizer
+		value ^= value >> 30;
+		value *= 0xbf58476d1ce4e5b9ull;
+		value ^= value >> 27;
+		value *= 0x94d049bb133111ebull;
+		return value ^ (value >> 31);
+	}
+}
+
+SampleCache::SampleCache(size_t capacity)
+	: m_slots(std::bit_ceil(std::max<size_t>(capacity, 16)))
+{
+	m_mask = m_slots.size() - 1;
+	m_maxSize = m_slots.size() / 4 * 3;
+}
+
+void SampleCache::lookup(std::span<const glm::vec2> positions, int maxIter, mandelbrot::Precision precision,
+	std::span<EscapeSample> samples, std::span<bool> found, bool withDistance)
+{
+	assert(positions.size() == samples.size() && positions.size() == found.size());
+	std::lock_guard lock(m_mutex);
+	for (size_t i = 0; i < positions.size(); ++i) {
+		Key key;
+		found[i] = false;
+		if (toKey(positions[i], key)) {
+			Slot& slot = m_slots[find(key)];
+			if (slot.occupied && slot.maxIter == maxIter && slot.precision >= precision
+				&& (!withDistance || slot.sample.distance >= 0)) {
+				slot.referenced = true;
+				samples[i] = slot.sample;
+				found[i] = true;
+			}
+		}
+		++(found[i] ? m_hits : m_misses);
+	}
+}
+
+void SampleCache::insert(std::span<const glm::vec2> positions, int maxIter, mandelbrot::Precision precision,
+	std::span<const EscapeSample> samples)
+{
+	assert(positions.size() == samples.size());
+	std::lock_guard lock(m_mutex);
+	for (size_t i = 0; i < positions.size(); ++i) {
+		Key key;
+		if (!toKey(positions[i], key)) {
+			continue;
+		}
+		size_t index = find(key);
+		if (!m_slots[index].occupied) {
+			if (m_size == m_maxSize) {
+				evictOne();
+				// Eviction moves slots around
+				index = find(key);
+			}
+			++m_size;
+		}
+		m_slots[index] = Slot{ key, samples[i], maxIter, precision, true, true };
+	}
+}
+
+void SampleCache::clear()
+{
+	std::lock_guard lock(m_mutex);
+	std::ranges::fill(m_slots, Slot{});
+	m_size = 0;
+	m_hand = 0;
+}
+
+SampleCache::Statistics SampleCache::getStatistics() const
+{
+	std::lock_guard lock(m_mutex);
+	return Statistics{ m_hits, m_misses, m_evictions, m_size };
+}
+
+bool SampleCache::toKey(glm::vec2 position, Key& key)
+{
+	if (!(std::abs(position.x) <= maxCoordinate && std::abs(position.y) <= maxCoordinate)) {
+		return false;
+	}
+	key.level = std::max({ latticeLevel(position.x), latticeLevel(position.y), 0 });
+	if (key.level > maxLevel) {
+		return false;
+	}
+	// Exact, both are integers at this level
+	key.x = static_cast<int64_t>(std::ldexp(static_cast<double>(position.x), key.level));
+	key.y = static_cast<int64_t>(std::ldexp(static_cast<double>(position.y), key.level));
+	return true;
+}
+
+size_t SampleCache::home(const Key& key) const
+{
+	const uint64_t hash = mix(static_cast<uint64_t>(key.x) * 0x9e3779b97f4a7c15ull
+		^ mix(static_cast<uint64_t>(key.y) + static_cast<uint64_t>(key.level)));
+	return static_cast<size_t>(hash) & m_mask;
+}
+
+size_t SampleCache::find(const Key& key) const
+{
+	// Never full, so there is always an empty slot to stop at
+	size_t index = home(key);
+	while (m_slots[index].occupied && !(m_slots[index].key == key)) {
+		index = (index + 1) & m_mask;
+	}
+	return index;
+}
+
+void SampleCache::evictOne()
+{
+	while (true) {
+		Slot& slot = m_slots[m_hand];
+		const size_t index = m_hand;
+		m_hand = (m_hand + 1) & m_mask;
+		if (!slot.occupied) {
+			continue;
+		}
+		if (slot.referenced) {
+			slot.referenced = false;
+			continue;
+		}
+		erase(index);
+		++m_evictions;
+		return;
+	}
+}
+
+void SampleCache::erase(size_t slot)
+{
+	// Backward shift: later slots of the probe sequence move into the hole if their home allows it
+	size_t hole = slot;
+	for (size_t next = (hole + 1) & m_mask; m_slots[next].occupied; next = (next + 1) & m_mask) {
+		const size_t distanceFromHome = (next - home(m_slots[next].key)) & m_mask;
+		if (distanceFromHome >= ((next - hole) & m_mask)) {
+			m_slots[hole] = m_slots[next];
+			hole = next;
+		}
+	}
+	m_slots[hole].occupied = false;
+	--m_size;
+}
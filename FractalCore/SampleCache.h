@@ -0,0 +1,77 @@
+#pragma once
+
+#include "Precision.h"
+
+// Result of iterating one point, enough to color it again
+struct EscapeSample {
+	int iterations;
+	std::complex<float> z;
+	float distance = -1; // Distance estimate, negative if it wasn't calculated
+};
+
+// Bounded cache of escape time samples. The mesh is refined by bisecting edges, so every vertex lies
+// on a dyadic lattice and a vertex removed with its triangles comes back at exactly the same position.
+// Samples are keyed by that lattice coordinate, in an open addressing table with CLOCK eviction.
+// Safe to use from several threads, every call locks once for the whole batch.
+class SampleCache
+{
+public:
+	struct Statistics {
+		uint64_t hits = 0;
+		uint64_t misses = 0;
+		uint64_t evictions = 0;
+		size_t size = 0;
+	};
+
+	// Holds up to 3/4 of capacity samples, capacity is rounded up to a power of two
+	explicit SampleCache(size_t capacity = 1 << 18);
+
+	// found[i] tells whether samples[i] was filled. Samples calculated with less precision
+	// or a different iteration limit are not used, nor samples without a distance if withDistance is set.
+	void lookup(std::span<const glm::vec2> positions, int maxIter, mandelbrot::Precision precision,
+		std::span<EscapeSample> samples, std::span<bool> found, bool withDistance = false);
+	void insert(std::span<const glm::vec2> positions, int maxIter, mandelbrot::Precision precision,
+		std::span<const EscapeSample> samples);
+
+	void clear();
+	Statistics getStatistics() const;
+
+private:
+	// position = (x, y) / 2^level
+	struct Key {
+		int64_t x;
+		int64_t y;
+		int level;
+
+		bool operator==(const Key&) const = default;
+	};
+
+	struct Slot {
+		Key key;
+		EscapeSample sample;
+		int maxIter;
+		mandelbrot::Precision precision;
+		bool occupied = false;
+		bool referenced = false; // Used since the clock hand last passed
+	};
+
+	// False for positions too fine for the lattice, those are not cached
+	static bool toKey(glm::vec2 position, Key& key);
+	size_t home(const Key& key) const;
+	// Slot of the key, or the empty slot where it would go
+	size_t find(const Key& key) const;
+	void evictOne();
+	void erase(size_t slot);
+
+	std::vector<Slot> m_slots;
+	size_t m_mask;
+	size_t m_maxSize;
+	size_t m_size = 0;
+	size_t m_hand = 0;
+
+	uint64_t m_hits = 0;
+	uint64_t m_misses = 0;
+	uint64_t m_evictions = 0;
+
+	mutable std::mutex m_mutex;
+};
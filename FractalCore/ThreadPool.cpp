@@ -0,0 +1,117 @@
+#include "pch.h"
+
+#include "ThreadPool.h"
+
+namespace {
+	thread_local bool insideJob = false;
+}
+
+ThreadPool::ThreadPool(unsigned threadCount)
+{
+	for (unsigned i = 1; i < threadCount; ++i) {
+		m_threads.emplace_back(&ThreadPool::threadMain, this);
+	}
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard lock(m_mutex);
+		m_stop = true;
+	}
+	m_wakeUp.notify_all();
+	for (auto& thread : m_threads) {
+		thread.join();
+	}
+}
+
+void ThreadPool::parallelFor(size_t count, size_t chunkSize, const std::function<void(size_t, size_t)>& function)
+{
+	if (count == 0) {
+		return;
+	}
+	chunkSize = std::max<size_t>(chunkSize, 1);
+	const size_t chunks = (count + chunkSize - 1) / chunkSize;
+	if (m_threads.empty() || chunks == 1 || insideJob) {
+		function(0, count);
+		return;
+	}
+
+	std::lock_guard submit(m_submitMutex);
+
+	auto job = std::make_shared<Job>();
+	job->function = &function;
+	job->count = count;
+	job->chunkSize = chunkSize;
+	job->chunks = chunks;
+	job->remaining = chunks;
+	{
+		std::lock_guard lock(m_mutex);
+		m_job = job;
+		++m_generation;
+	}
+	m_wakeUp.notify_all();
+
+	work(*job);
+
+	std::unique_lock lock(m_mutex);
+	m_done.wait(lock, [&] { return job->remaining == 0; });
+	m_job.reset();
+	lock.unlock();
+	if (job->error) {
+		std::rethrow_exception(job->error);
+	}
+}
+
+ThreadPool& ThreadPool::shared()
+{
+	static ThreadPool pool;
+	return pool;
+}
+
+void ThreadPool::threadMain()
+{
+	uint64_t seenGeneration = 0;
+	while (true) {
+		std::shared_ptr<Job> job;
+		{
+			std::unique_lock lock(m_mutex);
+			m_wakeUp.wait(lock, [&] { return m_stop || (m_job && m_generation != seenGeneration); });
+			if (m_stop) {
+				return;
+			}
+			seenGeneration = m_generation;
+			job = m_job;
+		}
+		work(*job);
+	}
+}
+
+void ThreadPool::work(Job& job)
+{
+	insideJob = true;
+	while (true) {
+		const size_t chunk = job.nextChunk.fetch_add(1);
+		if (chunk >= job.chunks) {
+			break;
+		}
+		const size_t begin = chunk * job.chunkSize;
+		const size_t end = std::min(job.count, begin + job.chunkSize);
+		if (!job.failed) {
+			try {
+				(*job.function)(begin, end);
+			}
+			catch (...) {
+				if (!job.failed.exchange(true)) {
+					job.error = std::current_exception();
+				}
+			}
+		}
+
+		if (job.remaining.fetch_sub(1) == 1) {
+			std::lock_guard lock(m_mutex);
+			m_done.notify_all();
+		}
+	}
+	insideJob = false;
+}
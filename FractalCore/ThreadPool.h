@@ -0,0 +1,48 @@
+#pragma once
+
+// Fixed set of worker threads for data parallel loops.
+class ThreadPool
+{
+public:
+	// threadCount includes the thread calling parallelFor, so one less thread is started
+	explicit ThreadPool(unsigned threadCount = std::thread::hardware_concurrency());
+	~ThreadPool();
+
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+
+	unsigned getThreadCount() const { return static_cast<unsigned>(m_threads.size()) + 1; }
+
+	// Calls function(begin, end) for consecutive chunks of [0, count) on all threads and returns when all are done.
+	// The calling thread takes part in the work. Calls from inside a chunk run serially.
+	// If a chunk throws, the chunks not started yet are skipped and the first exception is rethrown here.
+	void parallelFor(size_t count, size_t chunkSize, const std::function<void(size_t, size_t)>& function);
+
+	// Pool shared by the whole application, sized for the machine
+	static ThreadPool& shared();
+
+private:
+	struct Job {
+		const std::function<void(size_t, size_t)>* function;
+		size_t count;
+		size_t chunkSize;
+		size_t chunks;
+		std::atomic<size_t> nextChunk = 0;
+		std::atomic<size_t> remaining = 0;
+		std::atomic<bool> failed = false;
+		std::exception_ptr error; // Written once by whoever sets failed first
+	};
+
+	void threadMain();
+	void work(Job& job);
+
+	std::vector<std::thread> m_threads;
+
+	std::mutex m_submitMutex; // One job at a time
+	std::mutex m_mutex;
+	std::condition_variable m_wakeUp;
+	std::condition_variable m_done;
+	std::shared_ptr<Job> m_job;
+	uint64_t m_generation = 0;
+	bool m_stop = false;
+};
@@ -0,0 +1,174 @@
+#include "pch.h"
+
+#include "TileRenderer.h"
+#include "PngWriter.h"
+#include "ThreadPool.h"
+#include "MandelbrotSimd.h"
+#include "Mandelbrot.h"
+#include "DeepZoom.h"
+#include "Coloring.h"
+
+namespace {
+	// Pixels in a tile, a tile is part of a single row
+	constexpr uint32_t tileWidth = 256;
+
+	uint8_t toByte(float value) {
+		return static_cast<uint8_t>(std::clamp(value, 0.0f, 1.0f) * 255.0f + 0.5f);
+	}
+
+	// Smooth escape times of center + offset in float or double
+	template<typename NumericType>
+	void calculateTile(const RenderSettings& settings, std::span<const double> offsetsReal, double offsetImag, std::span<double> result) {
+		const double centerReal = static_cast<double>(settings.centerReal);
+		const double centerImag = static_cast<double>(settings.centerImag);
+		if constexpr (std::is_same_v<NumericType, float>) {
+			float real[tileWidth];
+			float imag[tileWidth];
+			for (size_t i = 0; i < offsetsReal.size(); ++i) {
+				real[i] = static_cast<float>(centerReal + offsetsReal[i]);
+				imag[i] = static_cast<float>(centerImag + offsetImag);
+			}
+			mandelbrot::calculateSmoothEscapeTimeBatch({ real, offsetsReal.size() }, { imag, offsetsReal.size() }, settings.maxIterations, result);
+		}
+		else {
+			const NumericType imag = NumericType(centerImag) + NumericType(offsetImag);
+			for (size_t i = 0; i < offsetsReal.size(); ++i) {
+				const auto escape = mandelbrot::calculateEscapeTime(NumericType(centerReal) + NumericType(offsetsReal[i]), imag, settings.maxIterations);
+				result[i] = mandelbrot::smoothIterationCount(escape.iterations, std::abs(escape.z), settings.maxIterations);
+			}
+		}
+	}
+
+	// Renders the image strip by strip and hands every strip to 'consume'. Stops if it returns false.
+	// calculate fills in the smooth escape times of a tile given as offsets from the center.
+	template<typename TileFunction, typename Consumer>
+	bool renderStrips(const RenderSettings& settings, std::ostream& progress, TileFunction&& calculate, Consumer&& consume)
+	{
+		// Pixels are placed as double offsets from the center, only the sum needs the extra precision
+		const double pixelSize = settings.width / settings.imageWidth;
+		const double left = -0.5 * settings.imageWidth * pixelSize;
+		const double top = 0.5 * settings.imageHeight * pixelSize;
+
+		const uint32_t stripHeight = std::max(1u, settings.stripHeight);
+		const uint32_t tilesPerRow = (settings.imageWidth + tileWidth - 1) / tileWidth;
+		const size_t rowSize = static_cast<size_t>(settings.imageWidth) * 3;
+		std::vector<uint8_t> strip(rowSize * stripHeight);
+
+		const auto start = std::chrono::steady_clock::now();
+		for (uint32_t firstRow = 0; firstRow < settings.imageHeight; firstRow += stripHeight) {
+			const uint32_t rows = std::min(stripHeight, settings.imageHeight - firstRow);
+
+			ThreadPool::shared().parallelFor(static_cast<size_t>(rows) * tilesPerRow, 1, [&](size_t begin, size_t end) {
+				double offsetsReal[tileWidth];
+				double escapeTimes[tileWidth];
+				for (size_t tile = begin; tile < end; ++tile) {
+					const uint32_t row = static_cast<uint32_t>(tile / tilesPerRow);
+					const uint32_t firstColumn = static_cast<uint32_t>(tile % tilesPerRow) * tileWidth;
+					const uint32_t count = std::min(tileWidth, settings.imageWidth - firstColumn);
+
+					const double offsetImag = top - (firstRow + row + 0.5) * pixelSize;
+					for (uint32_t i = 0; i < count; ++i) {
+						offsetsReal[i] = left + (firstColumn + i + 0.5) * pixelSize;
+					}
+					calculate(std::span<const double>(offsetsReal, count), offsetImag, std::span<double>(escapeTimes, count));
+
+					uint8_t* pixel = strip.data() + row * rowSize + static_cast<size_t>(firstColumn) * 3;
+					for (uint32_t i = 0; i < count; ++i) {
+						const Color color = coloring::getColor(escapeTimes[i]);
+						*pixel++ = toByte(color.r);
+						*pixel++ = toByte(color.g);
+						*pixel++ = toByte(color.b);
+					}
+				}
+			});
+
+			if (!consume(std::span<const uint8_t>(strip.data(), rowSize * rows), rows)) {
+				return false;
+			}
+
+			const auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+			progress << "\rRows " << firstRow + rows << " / " << settings.imageHeight << " (" << elapsed << " s)" << std::flush;
+		}
+		progress << std::endl;
+		return true;
+	}
+
+	// Chooses how the tiles are calculated and renders them with renderStrips
+	template<typename Consumer>
+	bool render(const RenderSettings& settings, std::ostream& progress, Consumer&& consume)
+	{
+		const double pixelSize = settings.width / settings.imageWidth;
+		const mandelbrot::Precision precision = mandelbrot::precisionForPixelSize(pixelSize);
+		progress << "Rendering " << mandelbrot::formulaName(settings.formula) << " with ";
+
+		// The Mandelbrot set has kernels of its own for every precision, the other formulas are calculated in double
+		const mandelbrot::FormulaKernel formulaKernel = settings.formula.isMandelbrot() ? nullptr : mandelbrot::findFormulaKernel(settings.formula);
+		if (formulaKernel) {
+			progress << "double precision" << std::endl;
+			const double centerReal = static_cast<double>(settings.centerReal);
+			const double centerImag = static_cast<double>(settings.centerImag);
+			return renderStrips(settings, progress, [&](std::span<const double> offsetsReal, double offsetImag, std::span<double> escapeTimes) {
+				double real[tileWidth];
+				double imag[tileWidth];
+				for (size_t i = 0; i < offsetsReal.size(); ++i) {
+					real[i] = centerReal + offsetsReal[i];
+					imag[i] = centerImag + offsetImag;
+				}
+				formulaKernel({ real, offsetsReal.size() }, { imag, offsetsReal.size() }, settings.juliaConstant, settings.maxIterations, escapeTimes);
+			}, consume);
+		}
+
+		// Beyond double only the reference orbit at the center is iterated with all the bits,
+		// the pixels iterate their differences to it in double
+		if (precision > mandelbrot::Precision::Double) {
+			const int limbs = mandelbrot::fixedPointLimbsForPixelSize(pixelSize);
+			progress << "perturbation around a " << limbs << " limb fixed point reference" << std::endl;
+			return mandelbrot::withFixedPoint(limbs, [&](auto zero) {
+				using Reference = decltype(zero);
+				mandelbrot::DeepZoom<Reference> deepZoom{ { Reference(settings.centerReal), Reference(settings.centerImag) }, settings.maxIterations };
+				deepZoom.enableBla(0.5 * pixelSize * std::hypot(settings.imageWidth, settings.imageHeight), pixelSize);
+				return renderStrips(settings, progress, [&](std::span<const double> offsetsReal, double offsetImag, std::span<double> escapeTimes) {
+					std::complex<double> offsets[tileWidth];
+					for (size_t i = 0; i < offsetsReal.size(); ++i) {
+						offsets[i] = { offsetsReal[i], offsetImag };
+					}
+					deepZoom.calculateSmoothEscapeTime({ offsets, offsetsReal.size() }, escapeTimes, nullptr);
+				}, consume);
+			});
+		}
+
+		progress << (precision == mandelbrot::Precision::Float ? "float" : "double") << " precision" << std::endl;
+		return renderStrips(settings, progress, [&](std::span<const double> offsetsReal, double offsetImag, std::span<double> escapeTimes) {
+			if (precision == mandelbrot::Precision::Float) {
+				calculateTile<float>(settings, offsetsReal, offsetImag, escapeTimes);
+			}
+			else {
+				calculateTile<double>(settings, offsetsReal, offsetImag, escapeTimes);
+			}
+		}, consume);
+	}
+}
+
+bool renderToPng(const RenderSettings& settings, const std::string& path, std::ostream& progress)
+{
+	auto writer = PngWriter::create(path, settings.imageWidth, settings.imageHeight);
+	if (!writer) {
+		return false;
+	}
+	const bool rendered = render(settings, progress, [&](std::span<const uint8_t> rows, uint32_t rowCount) {
+		return writer->writeRows(rows, rowCount);
+	});
+	return rendered && writer->finish();
+}
+
+std::vector<uint8_t> renderImage(const RenderSettings& settings)
+{
+	std::ostream noProgress(nullptr);
+	std::vector<uint8_t> image;
+	image.reserve(static_cast<size_t>(settings.imageWidth) * settings.imageHeight * 3);
+	render(settings, noProgress, [&](std::span<const uint8_t> rows, uint32_t) {
+		image.insert(image.end(), rows.begin(), rows.end());
+		return true;
+	});
+	return image;
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include "Precision.h"
+#include "Formula.h"
+
+// Viewport to render without a window
+struct RenderSettings {
+	// The center needs more than double precision for deep zooms. It is kept with the most limbs
+	// a reference orbit can have and cut down to the limbs the zoom needs.
+	using Coordinate = numeric::FixedPoint<mandelbrot::fixedPointLimbCounts.back()>;
+
+	Coordinate centerReal = -0.5;
+	Coordinate centerImag = 0.0;
+	double width = 3.0; // Of the viewport in the complex plane, the height follows from the image aspect
+	uint32_t imageWidth = 1920;
+	uint32_t imageHeight = 1080;
+	int maxIterations = 300;
+	uint32_t stripHeight = 64; // Rows rendered and written at a time
+	// Formulas other than the Mandelbrot set are calculated in double precision
+	mandelbrot::FormulaId formula;
+	std::complex<double> juliaConstant{ -0.8, 0.156 };
+};
+
+// Renders the image strip by strip with all cores and streams it to a png,
+// only one strip is in memory at a time. The numeric type is chosen from the pixel size,
+// float uses the vectorized kernels. Zooms beyond double iterate the differences to a fixed point
+// reference orbit at the center (mandelbrot::DeepZoom). Returns false if writing fails.
+bool renderToPng(const RenderSettings& settings, const std::string& path, std::ostream& progress);
+
+// Same as renderToPng but into memory, imageHeight rows of imageWidth * 3 bytes (8 bit RGB)
+std::vector<uint8_t> renderImage(const RenderSettings& settings);
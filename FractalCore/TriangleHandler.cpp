@@ -0,0 +1,941 @@
+#include "pch.h"
+
+#include "TriangleHandler.h"
+#include "ThreadPool.h"
+#include "Profiler.h"
+
+namespace {
+	// Vertices evaluated by one thread at a time, large enough to fill the simd lanes
+	constexpr size_t parallelChunkSize = 64;
+
+	// Triangles whose hypotenuse is shorter than this part of the view are about a pixel,
+	// they are not divided and diamonds that merge into them are merged
+	constexpr double minScreenSize = 1.0 / 1024;
+
+	// Cost of a triangle the boundary may run through, in the units of the squared palette distances.
+	// Added to the color term, so that a thin filament between corners of the same color is divided too.
+	constexpr double boundaryWeight = 0.03;
+
+	double viewSize(const geom::BBox2& screenBb) {
+		return std::max(screenBb.maxPoint.x - screenBb.minPoint.x, screenBb.maxPoint.y - screenBb.minPoint.y);
+	}
+}
+
+int TriangleHandler::generateVertices(const geom::BBox2& screenBb, int amount)
+{
+	profiler::ScopedTimer timer{ "generateVertices" };
+	m_scale = viewSize(screenBb);
+	if (m_positions.empty() || m_indices.empty()) {
+		generateInitialVertices();
+	}
+
+	// Triangles put aside for being too small may be worth dividing again
+	if (m_scale < m_tooSmallScale / 2) {
+		for (uint32_t triangle = 0; triangle < m_neighbors.size(); ++triangle) {
+			if (m_costs[triangle] < 0) {
+				m_costs[triangle] = calculateTriangleCost(triangle * 3);
+				m_costQueue.update(triangle, m_costs[triangle]);
+			}
+		}
+		m_tooSmallScale = 0;
+	}
+	const double minHypotenuse = minScreenSize * m_scale;
+
+	// Pick the globally most expensive triangles. A division also changes the neighbor across the
+	// hypotenuse, so a triangle is only picked if neither it nor that neighbor is part of the batch yet.
+	const size_t maxDivisions = constants::targetVertices - std::min(constants::targetVertices, m_positions.size() - m_freeEntries.size());
+	m_splitBatch.clear();
+	m_claimed.resize(m_neighbors.size());
+	m_taken.clear();
+
+	for (int i = 0; i < amount && !m_costQueue.empty() && m_splitBatch.size() < maxDivisions; ++i) {
+		const uint32_t index = m_costQueue.top().id;
+		m_taken.push_back(m_costQueue.top());
+		m_costQueue.erase(index);
+
+		// Same test as removeTrianglesOutsideScreen. A triangle can cover the screen without any of its vertices on it.
+		const uint32_t triangleIndex = index * 3;
+		if (!screenBb.collidesWith(m_quadtree.getBox(index))) {
+			m_costs[index] -= 1;
+			continue;
+		}
+
+		TriangleSplit split = findSplit(triangleIndex);
+		if (glm::distance(m_positions[split.hi0], m_positions[split.hi1]) < minHypotenuse) {
+			m_costs[index] -= 1;
+			m_tooSmallScale = std::max(m_tooSmallScale, m_scale);
+			continue;
+		}
+
+		// The neighbor is divided along the same edge. If that edge isn't its hypotenuse the neighbor is
+		// the larger one and gets divided first, otherwise both would only get thinner with every division.
+		int neighbor = m_neighbors[index][split.h0h1Edge];
+		while (neighbor >= 0) {
+			const TriangleSplit neighborSplit = findSplit(neighbor * 3);
+			if ((neighborSplit.hi0 == split.hi0 && neighborSplit.hi1 == split.hi1)
+				|| (neighborSplit.hi0 == split.hi1 && neighborSplit.hi1 == split.hi0)) {
+				break;
+			}
+			split = neighborSplit;
+			neighbor = m_neighbors[split.index / 3][split.h0h1Edge];
+		}
+
+		const uint32_t divided = split.index / 3;
+		if (m_claimed[divided] || (neighbor >= 0 && m_claimed[neighbor])) {
+			continue;
+		}
+		m_claimed[divided] = true;
+		if (neighbor >= 0) {
+			m_claimed[neighbor] = true;
+		}
+		m_splitBatch.push_back(split);
+	}
+
+	// Everything taken goes back with its current cost, divisions below update it again
+	for (const auto& entry : m_taken) {
+		m_claimed[entry.id] = false;
+		m_costQueue.push(entry.id, m_costs[entry.id]);
+	}
+	for (const auto& split : m_splitBatch) {
+		m_claimed[split.index / 3] = false;
+		const int neighbor = m_neighbors[split.index / 3][split.h0h1Edge];
+		if (neighbor >= 0) {
+			m_claimed[neighbor] = false;
+		}
+	}
+
+	// Evaluate all the new vertices in parallel
+	m_midpointBatch.resize(m_splitBatch.size());
+	for (size_t i = 0; i < m_splitBatch.size(); ++i) {
+		m_midpointBatch[i] = m_splitBatch[i].middle;
+	}
+	m_generatedBatch.resize(m_splitBatch.size());
+	m_generatedDistances.resize(m_splitBatch.size());
+	ThreadPool::shared().parallelFor(m_splitBatch.size(), parallelChunkSize, [&](size_t begin, size_t end) {
+		profiler::ScopedTimer timer{ "evaluate" };
+		m_vertexGenerator.generate(std::span(m_midpointBatch).subspan(begin, end - begin),
+			std::span(m_generatedBatch).subspan(begin, end - begin),
+			std::span(m_generatedDistances).subspan(begin, end - begin), m_scale, m_maxIterations);
+	});
+
+	for (size_t i = 0; i < m_splitBatch.size(); ++i) {
+		divideTriangle(m_splitBatch[i], m_generatedBatch[i], m_generatedDistances[i]);
+	}
+	return static_cast<int>(m_splitBatch.size());
+}
+
+int TriangleHandler::removeTrianglesOutsideScreen(const geom::BBox2& screenBb, int maxToRemove)
+{
+	profiler::ScopedTimer timer{ "removeTrianglesOutsideScreen" };
+	std::vector<uint32_t> indicesToRemove;
+	m_quadtree.findOutside(screenBb, maxToRemove, indicesToRemove);
+	if (indicesToRemove.empty()) {
+		return 0;
+	}
+
+	std::vector<uint32_t> verticesToRemove; // There are not neccessarily removed
+	for (auto& index : indicesToRemove) {
+		index *= 3;
+		verticesToRemove.push_back(m_indices[index]);
+		verticesToRemove.push_back(m_indices[index + 1]);
+		verticesToRemove.push_back(m_indices[index + 2]);
+	}
+
+	// The removal below needs the indices in order
+	std::ranges::sort(indicesToRemove);
+	// Go backwars so that removing doesn't 'shift' the other indices
+	for (int i = static_cast<int>(indicesToRemove.size()) - 1; i >= 0; --i) {
+		eraseTriangle(indicesToRemove[i] / 3);
+	}
+
+	std::ranges::sort(verticesToRemove);
+	auto [first, last] = std::ranges::unique(verticesToRemove);
+	verticesToRemove.erase(first, last);
+
+	// Mark as free
+	for (const auto& index : verticesToRemove) {
+		if (m_nrVertRef[index] == 0) {
+			m_freeEntries.push_back(index);
+		}
+	}
+
+	return static_cast<int>(indicesToRemove.size());
+}
+
+int TriangleHandler::mergeTriangles(const geom::BBox2& screenBb, int maxToMerge)
+{
+	profiler::ScopedTimer timer{ "mergeTriangles" };
+	// A merge has to be worth this many times less than the division it makes room for,
+	// so that the two don't keep undoing each other
+	constexpr double margin = 4;
+	const double minHypotenuse = minScreenSize * viewSize(screenBb);
+
+	// Takes the top of the queue if it still is the diamond it was queued as and 'worthIt' agrees
+	Diamond diamond;
+	const auto mergeTop = [&](const IndexedMaxHeap& queue, auto worthIt) {
+		while (!queue.empty()) {
+			const uint32_t center = queue.top().id;
+			// Removing triangles outside the screen may have broken up the diamond since it was queued
+			if (!findDiamond(center, diamond)) {
+				dropDiamond(center);
+				continue;
+			}
+			if (-m_mergeQueue.getKey(center) != mergeCost(diamond)
+				|| -m_mergeBySize.getKey(center) != glm::distance(m_positions[diamond.hi0], m_positions[diamond.hi1])) {
+				queueDiamond(diamond);
+				continue;
+			}
+			if (!worthIt()) {
+				return false;
+			}
+			dropDiamond(center);
+			mergeDiamond(diamond);
+			return true;
+		}
+		return false;
+	};
+
+	int merged = 0;
+	while (merged < maxToMerge && mergeTop(m_mergeBySize, [&] {
+		return glm::distance(m_positions[diamond.hi0], m_positions[diamond.hi1]) < minHypotenuse;
+	})) {
+		++merged;
+	}
+	while (merged < maxToMerge && !m_costQueue.empty() && mergeTop(m_mergeQueue, [&] {
+		return m_positions.size() - m_freeEntries.size() >= constants::targetVertices
+			&& mergeCost(diamond) * margin < m_costQueue.top().key;
+	})) {
+		++merged;
+	}
+	return merged;
+}
+
+void TriangleHandler::generateInitialVertices()
+{
+	// Everything may have been removed while the view was elsewhere
+	m_freeEntries.clear();
+	m_costs.clear();
+	m_neighbors.clear();
+	m_costQueue.clear();
+	m_mergeQueue.clear();
+	m_mergeBySize.clear();
+	m_quadtree.clear();
+
+	m_positions.reserve(constants::maxVertices);
+	m_escapeTimes.reserve(constants::maxVertices);
+	m_distances.reserve(constants::maxVertices);
+	m_nrVertRef.reserve(constants::maxVertices);
+	m_indices.reserve(constants::maxVertices*3);
+	m_freeEntries.reserve(constants::maxVertices);
+
+	const glm::vec2 corners[] = { {1,1}, {-1,1}, {-1,-1}, {1,-1} };
+	m_positions.assign(std::begin(corners), std::end(corners));
+	m_escapeTimes.resize(std::size(corners));
+	m_distances.resize(std::size(corners));
+	m_vertexGenerator.generate(m_positions, m_escapeTimes, m_distances, m_scale, m_maxIterations);
+
+	m_indices = std::vector<uint32_t>{
+		0,1,2,
+		2,3,0
+	};
+
+
+
+	m_costQueue.reserve(constants::maxVertices * 2);
+
+	addTriangleInfo(TriangleInfo{
+		.cost = calculateTriangleCost(0),
+		.neighbors = {-1, -1, 1}
+	});
+	addTriangleInfo(TriangleInfo{
+		.cost = calculateTriangleCost(3),
+		.neighbors = {-1, -1, 0}
+		});
+
+	m_nrVertRef = std::vector<int>{
+		2, 1, 2, 1
+	};
+
+	m_dirtyVertices.add(0, m_positions.size());
+	m_dirtyIndices.add(0, m_indices.size());
+}
+
+TriangleHandler::TriangleSplit TriangleHandler::findSplit(uint32_t index) const
+{
+	const uint32_t ti0 = m_indices[index];
+	const uint32_t ti1 = m_indices[index+1];
+	const uint32_t ti2 = m_indices[index+2];
+
+	const auto getMiddle = [&](uint32_t i1, uint32_t i2) -> glm::vec2 {
+		return (m_positions[i1] + m_positions[i2]) / 2.0f;
+	};
+
+	const auto squaredDistance = [](const glm::vec2& a, const glm::vec2& b	) {
+		const auto d = (a - b);
+		return glm::dot(d, d);
+	};
+	
+	float l0 = squaredDistance(m_positions[ti0], m_positions[ti1]);
+	float l1 = squaredDistance(m_positions[ti1], m_positions[ti2]);
+	float l2 = squaredDistance(m_positions[ti0], m_positions[ti2]);
+
+	// Hypotenusa
+	TriangleSplit split;
+	split.index = index;
+	if (l0 > l1 && l0 > l2) {
+		split.hi0 = ti0;
+		split.hi1 = ti1;
+		split.tip = ti2;
+		split.h0h1Edge = 0;
+		split.h0TipEdge = 2;
+		split.h1TipEdge = 1;
+	}
+	else if (l1 > l2) {
+		split.hi0 = ti1;
+		split.hi1 = ti2;
+		split.tip = ti0;
+		split.h0h1Edge = 1;
+		split.h0TipEdge = 0;
+		split.h1TipEdge = 2;
+	}
+	else {
+		split.hi0 = ti0;
+		split.hi1 = ti2;
+		split.tip = ti1;
+		split.h0h1Edge = 2;
+		split.h0TipEdge = 0;
+		split.h1TipEdge = 1;
+	}
+	split.middle = getMiddle(split.hi0, split.hi1);
+	return split;
+}
+
+void TriangleHandler::divideTriangle(const TriangleSplit& split, float middleEscapeTime, float middleDistance)
+{
+	// Neighbors are read only now, earlier divisions of the same batch may have changed them
+	const uint32_t index = split.index;
+	const uint32_t hi0 = split.hi0;
+	const uint32_t hi1 = split.hi1;
+	const uint32_t tip = split.tip;
+	const int h0h1Neighbor = m_neighbors[index / 3][split.h0h1Edge];
+	const int h0TipNeighbor = m_neighbors[index / 3][split.h0TipEdge];
+	const int h1TipNeighbor = m_neighbors[index / 3][split.h1TipEdge];
+
+	uint32_t newIndex;
+	if (m_freeEntries.empty()) {
+		newIndex = m_positions.size();
+		m_positions.push_back(split.middle);
+		m_escapeTimes.push_back(middleEscapeTime);
+		m_distances.push_back(middleDistance);
+		m_nrVertRef.push_back(0);
+	}
+	else {
+		newIndex = m_freeEntries.back();
+		m_freeEntries.pop_back();
+		m_positions[newIndex] = split.middle;
+		m_escapeTimes[newIndex] = middleEscapeTime;
+		m_distances[newIndex] = middleDistance;
+	}
+	m_dirtyVertices.add(newIndex, newIndex + 1);
+
+	const auto updateNeigbors = [&](int triangleToUpdate, int oldIndex, int newIndex) {
+		// Update the neighbors
+		if (triangleToUpdate >= 0) {
+			for (auto& n : m_neighbors[triangleToUpdate]) {
+				if (n == oldIndex) {
+					n = newIndex;
+				}
+			}
+		}
+	};
+
+	// Slice the (possibly) two triangles
+	const uint32_t newTriIndex = m_indices.size();
+
+	// Use the old triangle slot
+	m_indices[index] = newIndex;
+	m_indices[index + 1] = hi0;
+	m_indices[index + 2] = tip;
+	setTriangleInfo(index / 3, TriangleInfo{
+		.cost = calculateTriangleCost(index),
+		.neighbors = { 
+			h0h1Neighbor , 
+			h0TipNeighbor, 
+			static_cast<int>(newTriIndex/3)}
+	});
+
+
+	m_indices.push_back(newIndex);
+	m_indices.push_back(tip);
+	m_indices.push_back(hi1);
+	addTriangleInfo(TriangleInfo{
+		.cost = calculateTriangleCost(newTriIndex),
+		.neighbors = {
+			static_cast<int>(index/3), 
+			h1TipNeighbor, 
+			h0h1Neighbor >= 0 ? static_cast<int>(newTriIndex / 3) + 1 : -1}
+	});
+
+
+	m_dirtyIndices.add(index, index + 3);
+	m_dirtyIndices.add(newTriIndex, newTriIndex + 3);
+
+	// Update the neighbors
+	updateNeigbors(h1TipNeighbor, index/3, newTriIndex/3);
+
+	// Add vertex refs
+	m_nrVertRef[tip]++;
+	m_nrVertRef[newIndex] += 2;
+
+	// The new vertex is the center of a diamond, and the tips no longer are
+	const auto queueNewDiamond = [&] {
+		Diamond diamond;
+		if (findDiamond(newIndex, diamond)) {
+			queueDiamond(diamond);
+		}
+	};
+	dropDiamond(tip);
+
+	if (h0h1Neighbor < 0) {
+		queueNewDiamond();
+		return;
+	}
+
+	// Handle the neighbour triangle
+	const auto otherNeighbors = m_neighbors[h0h1Neighbor];
+	int otherTriangleIndex = h0h1Neighbor * 3;
+
+	int otherTip, otherH1Neighbor, otherH0Neighbor;
+	if (m_indices[otherTriangleIndex] != hi0 && m_indices[otherTriangleIndex] != hi1) {
+		otherTip = m_indices[otherTriangleIndex];
+		if (m_indices[otherTriangleIndex + 1] == hi0) {
+			otherH0Neighbor = otherNeighbors[0];
+			otherH1Neighbor = otherNeighbors[2];
+		}
+		else {
+			assert((m_indices[otherTriangleIndex + 2]) == hi0);
+			otherH0Neighbor = otherNeighbors[2];
+			otherH1Neighbor = otherNeighbors[0];
+		}
+	}
+	else if (m_indices[otherTriangleIndex+1] != hi0 && m_indices[otherTriangleIndex+1] != hi1) {
+		otherTip = m_indices[otherTriangleIndex + 1];
+		if (m_indices[otherTriangleIndex + 2] == hi0) {
+			otherH0Neighbor = otherNeighbors[1];
+			otherH1Neighbor = otherNeighbors[0];
+		}
+		else {
+			assert((m_indices[otherTriangleIndex]) == hi0);
+			otherH0Neighbor = otherNeighbors[0];
+			otherH1Neighbor = otherNeighbors[1];
+		}
+	}
+	else {
+		otherTip = m_indices[otherTriangleIndex + 2];
+		if (m_indices[otherTriangleIndex] == hi0) {
+			otherH0Neighbor = otherNeighbors[2];
+			otherH1Neighbor = otherNeighbors[1];
+		}
+		else {
+			assert((m_indices[otherTriangleIndex+1]) == hi0);
+			otherH0Neighbor = otherNeighbors[1];
+			otherH1Neighbor = otherNeighbors[2];
+		}
+	}
+
+	// Use the old triangle slot
+	m_indices[otherTriangleIndex] = newIndex;
+	m_indices[otherTriangleIndex + 1] = hi0;
+	m_indices[otherTriangleIndex + 2] = otherTip;
+	setTriangleInfo(otherTriangleIndex/3, TriangleInfo{
+		.cost = calculateTriangleCost(otherTriangleIndex),
+		.neighbors = {
+			static_cast<int> (index/3),
+			otherH0Neighbor, 
+			static_cast<int>(newTriIndex/3)+1}
+	});
+
+
+	m_indices.push_back(newIndex);
+	m_indices.push_back(otherTip);
+	m_indices.push_back(hi1);
+	addTriangleInfo(TriangleInfo{
+		.cost = calculateTriangleCost(newTriIndex+3),
+		.neighbors = {
+			static_cast<int>(otherTriangleIndex/3), 
+			otherH1Neighbor, 
+			static_cast<int>(newTriIndex/3)}
+		});
+
+	m_dirtyIndices.add(otherTriangleIndex, otherTriangleIndex + 3);
+	m_dirtyIndices.add(newTriIndex + 3, newTriIndex + 6);
+
+	// Add vertex refs
+	m_nrVertRef[otherTip]++;
+	m_nrVertRef[newIndex] += 2;
+
+	// Update the neighbors
+	updateNeigbors(otherH1Neighbor, otherTriangleIndex/3, newTriIndex/3 + 1);
+
+	dropDiamond(otherTip);
+	queueNewDiamond();
+
+	//validateTriangleNegihbors();
+}
+
+void TriangleHandler::setTriangleInfo(uint32_t triangle, const TriangleInfo& info)
+{
+	m_costs[triangle] = info.cost;
+	m_neighbors[triangle] = info.neighbors;
+	m_costQueue.update(triangle, info.cost);
+	m_quadtree.update(triangle, triangleBox(triangle * 3));
+}
+
+void TriangleHandler::addTriangleInfo(const TriangleInfo& info)
+{
+	m_costs.push_back(info.cost);
+	m_neighbors.push_back(info.neighbors);
+	const uint32_t triangle = static_cast<uint32_t>(m_neighbors.size() - 1);
+	m_costQueue.push(triangle, info.cost);
+	m_quadtree.insert(triangle, triangleBox(triangle * 3));
+}
+
+bool TriangleHandler::findDiamond(uint32_t center, Diamond& diamond)
+{
+	const int count = center < m_nrVertRef.size() ? m_nrVertRef[center] : 0;
+	if (count != 2 && count != 4) {
+		return false;
+	}
+
+	// The triangles around the center are the ones whose box touches it and that use it
+	const glm::vec2 position = m_positions[center];
+	m_diamondCandidates.clear();
+	m_quadtree.findColliding(geom::BBox2{ position, position }, m_diamondCandidates);
+	uint32_t triangles[4];
+	int found = 0;
+	for (uint32_t triangle : m_diamondCandidates) {
+		const uint32_t* vertices = &m_indices[triangle * 3];
+		if (vertices[0] == center || vertices[1] == center || vertices[2] == center) {
+			if (found == count) {
+				return false;
+			}
+			triangles[found++] = triangle;
+		}
+	}
+	if (found != count) {
+		return false;
+	}
+
+	// The other vertices, and how many of the triangles use each of them
+	uint32_t outer[4];
+	int uses[4] = {};
+	int outerCount = 0;
+	for (int t = 0; t < count; ++t) {
+		for (int i = 0; i < 3; ++i) {
+			const uint32_t vertex = m_indices[triangles[t] * 3 + i];
+			if (vertex == center) {
+				continue;
+			}
+			const int slot = static_cast<int>(std::find(outer, outer + outerCount, vertex) - outer);
+			if (slot == outerCount) {
+				if (outerCount == 4) {
+					return false;
+				}
+				outer[outerCount++] = vertex;
+			}
+			++uses[slot];
+		}
+	}
+
+	const auto hasBoth = [&](int t, uint32_t a, uint32_t b) {
+		const uint32_t* vertices = &m_indices[triangles[t] * 3];
+		return std::count(vertices, vertices + 3, a) + std::count(vertices, vertices + 3, b) == 2;
+	};
+
+	diamond.center = center;
+	diamond.sides = count / 2;
+	if (count == 2) {
+		// At the border the tip is shared and the ends of the divided edge are not
+		if (outerCount != 3) {
+			return false;
+		}
+		const int tip = static_cast<int>(std::find(uses, uses + 3, 2) - uses);
+		if (tip == 3) {
+			return false;
+		}
+		diamond.tips[0] = outer[tip];
+		diamond.hi0 = outer[(tip + 1) % 3];
+		diamond.hi1 = outer[(tip + 2) % 3];
+	}
+	else {
+		// The end opposite to outer[0] is the one it doesn't share a triangle with
+		if (outerCount != 4) {
+			return false;
+		}
+		int opposite = -1;
+		for (int o = 1; o < 4; ++o) {
+			bool shared = false;
+			for (int t = 0; t < 4; ++t) {
+				shared = shared || hasBoth(t, outer[0], outer[o]);
+			}
+			if (!shared) {
+				opposite = o;
+			}
+		}
+		if (opposite < 0) {
+			return false;
+		}
+		diamond.hi0 = outer[0];
+		diamond.hi1 = outer[opposite];
+		int tip = 0;
+		for (int o = 1; o < 4; ++o) {
+			if (o != opposite) {
+				diamond.tips[tip++] = outer[o];
+			}
+		}
+	}
+
+	// Merging has to give back the edge the center was added on
+	if ((m_positions[diamond.hi0] + m_positions[diamond.hi1]) / 2.0f != position) {
+		return false;
+	}
+
+	for (int side = 0; side < diamond.sides; ++side) {
+		for (int end = 0; end < 2; ++end) {
+			const uint32_t hi = end == 0 ? diamond.hi0 : diamond.hi1;
+			int match = -1;
+			for (int t = 0; t < count; ++t) {
+				if (hasBoth(t, hi, diamond.tips[side])) {
+					match = t;
+				}
+			}
+			if (match < 0) {
+				return false;
+			}
+			diamond.triangles[side][end] = triangles[match];
+		}
+	}
+	return true;
+}
+
+double TriangleHandler::mergeCost(const Diamond& diamond) const
+{
+	double cost = 0;
+	for (int side = 0; side < diamond.sides; ++side) {
+		cost = std::max(cost, calculateTriangleCost(diamond.hi0, diamond.tips[side], diamond.hi1));
+	}
+	return cost;
+}
+
+void TriangleHandler::queueDiamond(const Diamond& diamond)
+{
+	m_mergeQueue.update(diamond.center, -mergeCost(diamond));
+	m_mergeBySize.update(diamond.center, -glm::distance(m_positions[diamond.hi0], m_positions[diamond.hi1]));
+}
+
+void TriangleHandler::dropDiamond(uint32_t center)
+{
+	if (m_mergeQueue.contains(center)) {
+		m_mergeQueue.erase(center);
+		m_mergeBySize.erase(center);
+	}
+}
+
+void TriangleHandler::mergeDiamond(const Diamond& diamond)
+{
+	// Edge (a, b) of the triangle as an index to TriangleInfo::neighbors
+	const auto edgeOf = [&](uint32_t triangle, uint32_t a, uint32_t b) {
+		const uint32_t* vertices = &m_indices[triangle * 3];
+		const auto isEdge = [&](int i, int j) {
+			return (vertices[i] == a && vertices[j] == b) || (vertices[i] == b && vertices[j] == a);
+		};
+		return isEdge(0, 1) ? 0 : isEdge(1, 2) ? 1 : 2;
+	};
+
+	// Each side becomes the triangle (hi0, tip, hi1) in the slot of its triangle at hi0,
+	// the triangle at hi1 goes away
+	int parents[2] = { static_cast<int>(diamond.triangles[0][0]), -1 };
+	if (diamond.sides == 2) {
+		parents[1] = static_cast<int>(diamond.triangles[1][0]);
+	}
+	int outside[2][2]; // [side][across hi0-tip, across tip-hi1]
+	for (int side = 0; side < diamond.sides; ++side) {
+		const uint32_t atHi0 = diamond.triangles[side][0];
+		const uint32_t atHi1 = diamond.triangles[side][1];
+		outside[side][0] = m_neighbors[atHi0][edgeOf(atHi0, diamond.hi0, diamond.tips[side])];
+		outside[side][1] = m_neighbors[atHi1][edgeOf(atHi1, diamond.tips[side], diamond.hi1)];
+		if (outside[side][1] >= 0) {
+			for (auto& neighbor : m_neighbors[outside[side][1]]) {
+				if (neighbor == static_cast<int>(atHi1)) {
+					neighbor = parents[side];
+				}
+			}
+		}
+	}
+
+	for (int side = 0; side < diamond.sides; ++side) {
+		const uint32_t index = static_cast<uint32_t>(parents[side]) * 3;
+		m_nrVertRef[m_indices[index]]--;
+		m_nrVertRef[m_indices[index + 1]]--;
+		m_nrVertRef[m_indices[index + 2]]--;
+		m_indices[index] = diamond.hi0;
+		m_indices[index + 1] = diamond.tips[side];
+		m_indices[index + 2] = diamond.hi1;
+		m_nrVertRef[diamond.hi0]++;
+		m_nrVertRef[diamond.tips[side]]++;
+		m_nrVertRef[diamond.hi1]++;
+		m_dirtyIndices.add(index, index + 3);
+		setTriangleInfo(index / 3, TriangleInfo{
+			.cost = calculateTriangleCost(index),
+			.neighbors = { outside[side][0], outside[side][1], parents[1 - side] }
+		});
+	}
+
+	// Nothing refers to the triangles at hi1 anymore. Erased from the back so that the second index stays valid.
+	uint32_t removed[2] = { diamond.triangles[0][1], diamond.triangles[1][1] };
+	for (int side = 0; side < diamond.sides; ++side) {
+		std::ranges::fill(m_neighbors[removed[side]], -1);
+	}
+	if (diamond.sides == 2 && removed[1] > removed[0]) {
+		std::swap(removed[0], removed[1]);
+	}
+	for (int side = 0; side < diamond.sides; ++side) {
+		eraseTriangle(removed[side]);
+	}
+
+	assert(m_nrVertRef[diamond.center] == 0);
+	m_freeEntries.push_back(diamond.center);
+
+	// The tips may have become centers of diamonds again
+	Diamond parent;
+	for (int side = 0; side < diamond.sides; ++side) {
+		if (findDiamond(diamond.tips[side], parent)) {
+			queueDiamond(parent);
+		}
+	}
+}
+
+void TriangleHandler::eraseTriangle(uint32_t triangle)
+{
+	const uint32_t last = static_cast<uint32_t>(m_neighbors.size() - 1);
+	const auto replaceNeighbor = [&](const std::array<int, 3>& neighbors, int from, int to) {
+		for (int neighbor : neighbors) {
+			if (neighbor < 0) {
+				continue;
+			}
+			for (auto& nn : m_neighbors[neighbor]) {
+				if (nn == from) {
+					nn = to;
+				}
+			}
+		}
+	};
+
+	replaceNeighbor(m_neighbors[triangle], triangle, -1);
+	m_nrVertRef[m_indices[triangle * 3]]--;
+	m_nrVertRef[m_indices[triangle * 3 + 1]]--;
+	m_nrVertRef[m_indices[triangle * 3 + 2]]--;
+	m_costQueue.erase(triangle);
+	m_quadtree.erase(triangle);
+
+	if (triangle != last) {
+		replaceNeighbor(m_neighbors[last], last, triangle);
+		std::copy_n(m_indices.begin() + last * 3, 3, m_indices.begin() + triangle * 3);
+		m_costs[triangle] = m_costs[last];
+		m_neighbors[triangle] = m_neighbors[last];
+		m_costQueue.rename(last, triangle);
+		m_quadtree.rename(last, triangle);
+		m_dirtyIndices.add(triangle * 3, triangle * 3 + 3);
+	}
+	m_indices.resize(last * 3);
+	m_costs.pop_back();
+	m_neighbors.pop_back();
+}
+
+void TriangleHandler::removeVerices(const std::vector<uint32_t>& vertexIndices)
+{
+	for (int i = static_cast<int>(vertexIndices.size()) - 1; i >= 0; --i) {
+		// Swap the vertex to the end, erase it and update the swapped vertex indices
+		const uint32_t index = vertexIndices[i];
+		const uint32_t last = m_positions.size() - 1;
+		m_positions[index] = m_positions[last];
+		m_escapeTimes[index] = m_escapeTimes[last];
+		m_distances[index] = m_distances[last];
+		for (uint32_t j = 0; j < m_indices.size(); ++j) {
+			if (m_indices[j] == last) {
+				m_indices[j] = index;
+			}
+		}
+		m_positions.pop_back();
+		m_escapeTimes.pop_back();
+		m_distances.pop_back();
+		m_dirtyVertices.add(index, index + 1);
+	}
+	m_dirtyIndices.add(0, m_indices.size());
+}
+
+void TriangleHandler::takeDirtyRanges(DirtyRanges& vertices, DirtyRanges& indices)
+{
+	vertices.add(m_dirtyVertices);
+	indices.add(m_dirtyIndices);
+	m_dirtyVertices.clear();
+	m_dirtyIndices.clear();
+}
+
+void TriangleHandler::snapshot(const geom::BBox2& view, MeshSnapshotData& data) const
+{
+	profiler::ScopedTimer timer{ "snapshot" };
+	data.view = view;
+	data.scale = m_scale;
+	data.tooSmallScale = m_tooSmallScale;
+	data.maxIterations = m_maxIterations;
+	data.positions.assign(m_positions.begin(), m_positions.end());
+	data.escapeTimes.assign(m_escapeTimes.begin(), m_escapeTimes.end());
+	data.distances.assign(m_distances.begin(), m_distances.end());
+	data.indices = m_indices;
+	data.vertexReferences = m_nrVertRef;
+	data.freeEntries = m_freeEntries;
+	data.costs.assign(m_costs.begin(), m_costs.end());
+	data.neighbors.assign(m_neighbors.begin(), m_neighbors.end());
+
+	const auto copyQueue = [](const IndexedMaxHeap& queue, std::vector<SnapshotQueueEntry>& entries) {
+		entries.clear();
+		for (const auto& entry : queue.getEntries()) {
+			entries.push_back({ entry.key, entry.id });
+		}
+	};
+	copyQueue(m_mergeQueue, data.mergeQueue);
+	copyQueue(m_mergeBySize, data.mergeBySize);
+}
+
+bool TriangleHandler::restore(const MeshSnapshot& snapshot)
+{
+	profiler::ScopedTimer timer{ "restore" };
+	if (snapshot.getMaxIterations() != m_maxIterations || snapshot.getPositions().size() > constants::maxVertices
+		|| snapshot.getIndices().size() > constants::maxIndices) {
+		return false;
+	}
+
+	m_scale = snapshot.getScale();
+	m_tooSmallScale = snapshot.getTooSmallScale();
+	m_positions.assign(snapshot.getPositions().begin(), snapshot.getPositions().end());
+	m_escapeTimes.assign(snapshot.getEscapeTimes().begin(), snapshot.getEscapeTimes().end());
+	m_distances.assign(snapshot.getDistances().begin(), snapshot.getDistances().end());
+	m_indices.assign(snapshot.getIndices().begin(), snapshot.getIndices().end());
+	m_nrVertRef.assign(snapshot.getVertexReferences().begin(), snapshot.getVertexReferences().end());
+	m_freeEntries.assign(snapshot.getFreeEntries().begin(), snapshot.getFreeEntries().end());
+	m_costs.assign(snapshot.getCosts().begin(), snapshot.getCosts().end());
+	m_neighbors.assign(snapshot.getNeighbors().begin(), snapshot.getNeighbors().end());
+
+	// The heaps take their entries as they are and only restore the heap order, which is linear
+	std::vector<IndexedMaxHeap::Entry> entries;
+	const auto assignQueue = [&](IndexedMaxHeap& queue, std::span<const SnapshotQueueEntry> saved) {
+		entries.clear();
+		for (const auto& entry : saved) {
+			entries.push_back({ entry.key, entry.id });
+		}
+		queue.assign(entries);
+	};
+	assignQueue(m_mergeQueue, snapshot.getMergeQueue());
+	assignQueue(m_mergeBySize, snapshot.getMergeBySize());
+	entries.clear();
+	for (uint32_t triangle = 0; triangle < m_costs.size(); ++triangle) {
+		entries.push_back({ m_costs[triangle], triangle });
+	}
+	m_costQueue.reserve(constants::maxVertices * 2);
+	m_costQueue.assign(entries);
+
+	m_quadtree.clear();
+	for (uint32_t triangle = 0; triangle < m_neighbors.size(); ++triangle) {
+		m_quadtree.insert(triangle, triangleBox(triangle * 3));
+	}
+
+	m_dirtyVertices.clear();
+	m_dirtyIndices.clear();
+	m_dirtyVertices.add(0, m_positions.size());
+	m_dirtyIndices.add(0, m_indices.size());
+	return true;
+}
+
+geom::BBox2 TriangleHandler::triangleBox(uint32_t index) const
+{
+	return { m_positions[m_indices[index]], m_positions[m_indices[index + 1]], m_positions[m_indices[index + 2]] };
+}
+
+double TriangleHandler::calculateTriangleCost(uint32_t index) const
+{
+	return calculateTriangleCost(m_indices[index], m_indices[index + 1], m_indices[index + 2]);
+}
+
+double TriangleHandler::calculateTriangleCost(uint32_t v0, uint32_t v1, uint32_t v2) const
+{
+	const auto squaredDistance = [](const glm::vec2& a, const glm::vec2& b) {
+		const auto d = (a - b);
+		return glm::dot(d, d);
+	};
+
+	// Measured in palette colors, a difference of more than one color counts as one
+	const auto squaredPaletteDistance = [](float a, float b) {
+		const double d = std::min(std::abs(a - b) / coloring::paletteStep, 1.0);
+		return d * d;
+	};
+
+	const double colorDiff = squaredPaletteDistance(m_escapeTimes[v0], m_escapeTimes[v1])
+					  + squaredPaletteDistance(m_escapeTimes[v1], m_escapeTimes[v2])
+						+ squaredPaletteDistance(m_escapeTimes[v0], m_escapeTimes[v2]);
+
+	double lenghts[3];
+
+	lenghts[0] = squaredDistance(m_positions[v0], m_positions[v1]);
+	lenghts[1] = squaredDistance(m_positions[v1], m_positions[v2]);
+	lenghts[2] = squaredDistance(m_positions[v0], m_positions[v2]);
+	
+	const double totalSideLen = lenghts[0] + lenghts[1] + lenghts[2];
+
+	//const double slRatio = std::ranges::max(lenghts) / std::ranges::min(lenghts);
+
+	// The boundary of the set may run through a triangle that is larger than the distance from its vertices
+	// to the boundary, those are divided first. Without distance estimates the distances are infinite.
+	const double closest = std::min({ m_distances[v0], m_distances[v1], m_distances[v2] });
+	const double nearBoundary = std::min(std::sqrt(std::ranges::max(lenghts)) / closest, 1.0);
+
+	return (0.0001 + colorDiff + boundaryWeight * nearBoundary) * ((totalSideLen/**slRation*/));
+}
+
+void TriangleHandler::validateTriangleNegihbors()
+{
+	for (size_t t = 0; t < m_indices.size(); t += 3) {
+
+		const uint32_t t1 = m_indices[t], t2 = m_indices[t + 1], t3 = m_indices[t + 2];
+		[[maybe_unused]] const auto& neighbors = m_neighbors[t / 3];
+
+		for (int e = 0; e < 3; ++e) {
+			uint32_t e1 = 0, e2 = 0;
+			if (e == 0) {
+				e1 = t1;
+				e2 = t2;
+			}
+			if (e == 1) {
+				e1 = t2;
+				e2 = t3;
+			}
+			if (e == 2) {
+				e1 = t3;
+				e2 = t1;
+			}
+
+			[[maybe_unused]] int neighbor = -1;
+
+			// Find the other triangle with the edge
+			for (size_t i = 0; i < m_indices.size(); i += 3) {
+				if ((m_indices[i] == e1 || m_indices[i + 1] == e1 || m_indices[i + 2] == e1)
+					&& (m_indices[i] == e2 || m_indices[i + 1] == e2 || m_indices[i + 2] == e2) && i != t) {
+					
+					neighbor = static_cast<int>(i/3);
+				}
+			}
+
+			assert(neighbor == neighbors[e]);
+		}
+	}
+}
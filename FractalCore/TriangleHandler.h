@@ -0,0 +1,215 @@
+#pragma once
+
+#include "utils.h"
+#include "IndexedMaxHeap.h"
+#include "TriangleQuadtree.h"
+#include "DirtyRanges.h"
+#include "Coloring.h"
+#include "AlignedAllocator.h"
+#include "MeshSnapshot.h"
+
+// Layout of the vertex buffer. The mesh itself keeps positions and escape times in separate arrays.
+// The escape time is mapped to the palette only when drawing.
+struct Vertex {
+	glm::vec2 pos;
+	float escapeTime;
+};
+
+struct TriangleInfo {
+	double cost;
+	std::array<int, 3> neighbors;
+};
+
+// Anything that fills in the smooth escape times of the vertices at the given positions, a whole batch at a time.
+// scale is the size of the view the vertices are generated for.
+template<typename Generator>
+concept BatchVertexGenerator = requires(const Generator& generator, std::span<const glm::vec2> positions,
+	std::span<float> escapeTimes, double scale, int maxIter) {
+	generator.generate(positions, escapeTimes, scale, maxIter);
+};
+
+// A BatchVertexGenerator that can also estimate the distance from every position to the boundary of the set.
+// Interior points, and all points when the generator doesn't estimate distances, get infinity.
+template<typename Generator>
+concept DistanceEstimatingGenerator = BatchVertexGenerator<Generator> && requires(const Generator& generator,
+	std::span<const glm::vec2> positions, std::span<float> escapeTimes, std::span<float> distances, double scale, int maxIter) {
+	generator.generate(positions, escapeTimes, distances, scale, maxIter);
+};
+
+// Type erased BatchVertexGenerator. The indirect call is paid once per batch,
+// the generator itself is free to inline and vectorize over the batch.
+class VertexGenerator
+{
+public:
+	template<BatchVertexGenerator Generator>
+	VertexGenerator(Generator generator)
+		: m_generator(std::make_shared<const Model<Generator>>(std::move(generator))) {}
+
+	// Must be safe to call from several threads at once
+	void generate(std::span<const glm::vec2> positions, std::span<float> escapeTimes, double scale, int maxIter) const {
+		assert(positions.size() == escapeTimes.size());
+		m_generator->generate(positions, escapeTimes, scale, maxIter);
+	}
+
+	// Same with distance estimates, see DistanceEstimatingGenerator
+	void generate(std::span<const glm::vec2> positions, std::span<float> escapeTimes, std::span<float> distances,
+		double scale, int maxIter) const {
+		assert(positions.size() == escapeTimes.size() && positions.size() == distances.size());
+		m_generator->generate(positions, escapeTimes, distances, scale, maxIter);
+	}
+
+private:
+	struct Concept {
+		virtual ~Concept() = default;
+		virtual void generate(std::span<const glm::vec2> positions, std::span<float> escapeTimes, double scale, int maxIter) const = 0;
+		virtual void generate(std::span<const glm::vec2> positions, std::span<float> escapeTimes, std::span<float> distances,
+			double scale, int maxIter) const = 0;
+	};
+
+	template<typename Generator>
+	struct Model final : Concept {
+		Model(Generator generator) : generator(std::move(generator)) {}
+		void generate(std::span<const glm::vec2> positions, std::span<float> escapeTimes, double scale, int maxIter) const override {
+			generator.generate(positions, escapeTimes, scale, maxIter);
+		}
+		void generate(std::span<const glm::vec2> positions, std::span<float> escapeTimes, std::span<float> distances,
+			double scale, int maxIter) const override {
+			if constexpr (DistanceEstimatingGenerator<Generator>) {
+				generator.generate(positions, escapeTimes, distances, scale, maxIter);
+			}
+			else {
+				generator.generate(positions, escapeTimes, scale, maxIter);
+				std::ranges::fill(distances, std::numeric_limits<float>::infinity());
+			}
+		}
+		Generator generator;
+	};
+
+	std::shared_ptr<const Concept> m_generator;
+};
+
+namespace constants {
+	constexpr size_t maxVertices = 100000;
+	constexpr size_t maxIndices = maxVertices * 6; // A triangulation has less than two triangles per vertex
+	constexpr size_t targetVertices = maxVertices * 9 / 10; // Dividing stops here, merging trades around it
+	constexpr int maxIterations = 300;
+
+}
+
+class TriangleHandler
+{
+public:
+	TriangleHandler(const VertexGenerator vgen):m_vertexGenerator(vgen) {}
+
+	// Returns the number of triangles divided
+	int generateVertices(const geom::BBox2& screenBb, int amount);
+	// Returns the number of triangles removed
+	int removeTrianglesOutsideScreen(const geom::BBox2& screenBb, int maxToRemove);
+	// Inverse of the division, diamonds are merged back into their parents. Diamonds that merge into
+	// triangles of about a pixel on the screen always are. Once the mesh has reached its target size the
+	// cheapest ones are traded for divisions that are clearly worth more. Returns the number of diamonds merged.
+	int mergeTriangles(const geom::BBox2& screenBb, int maxToMerge);
+
+	// Vertex i is at getPositions()[i] with the escape time getEscapeTimes()[i]
+	const AlignedVector<glm::vec2>& getPositions() const { return m_positions; }
+	const AlignedVector<float>& getEscapeTimes() const { return m_escapeTimes; }
+	const std::vector<uint32_t>& getIndeices() const { return m_indices; }
+	// Vertices in use, the arrays above also hold freed ones
+	size_t getVertexCount() const { return m_positions.size() - m_freeEntries.size(); }
+
+	// Adds the vertex and index ranges written since the last call to the given sets
+	void takeDirtyRanges(DirtyRanges& vertices, DirtyRanges& indices);
+
+	// Copies the mesh into 'data' for saving, 'view' is saved with it
+	void snapshot(const geom::BBox2& view, MeshSnapshotData& data) const;
+	// Continues from a saved mesh instead of the current one. The queues and the quadtree are built again,
+	// everything else is copied as it is. Returns false if the snapshot was made with other limits.
+	bool restore(const MeshSnapshot& snapshot);
+
+private:
+	// Division of a triangle along its hypotenuse, everything that can be decided before
+	// the new vertex is evaluated
+	struct TriangleSplit {
+		uint32_t index; // Start index in m_indices
+		uint32_t hi0, hi1, tip;
+		int h0h1Edge, h0TipEdge, h1TipEdge; // Indices to TriangleInfo::neighbors
+		glm::vec2 middle;
+	};
+
+	// The triangles around a vertex added by divideTriangle while none of them is divided further.
+	// Two sides, or one at the border of the mesh.
+	struct Diamond {
+		uint32_t center;
+		uint32_t hi0, hi1; // Ends of the edge that the center divided
+		uint32_t tips[2];
+		uint32_t triangles[2][2]; // [side][touches hi0, touches hi1]
+		int sides;
+	};
+
+	void generateInitialVertices();
+	TriangleSplit findSplit(uint32_t index) const;
+	void divideTriangle(const TriangleSplit& split, float middleEscapeTime, float middleDistance);
+
+	// Write triangle infos through these to keep the cost queue and the quadtree up to date.
+	// The indices of the triangle must be written first.
+	void setTriangleInfo(uint32_t triangle, const TriangleInfo& info);
+	void addTriangleInfo(const TriangleInfo& info);
+
+	bool findDiamond(uint32_t center, Diamond& diamond);
+	// Cost of the triangles the diamond merges into
+	double mergeCost(const Diamond& diamond) const;
+	void mergeDiamond(const Diamond& diamond);
+	// Keeps the diamond in both merge queues, or takes its center out of them
+	void queueDiamond(const Diamond& diamond);
+	void dropDiamond(uint32_t center);
+
+	// Removes the triangle and moves the last one into its place. Vertices are not freed.
+	void eraseTriangle(uint32_t triangle);
+
+	// Note: triangles should already be removed!
+	void removeVerices(const std::vector<uint32_t>& vertexIndices);
+
+	// start index
+	geom::BBox2 triangleBox(uint32_t index) const;
+
+	// start index
+	double calculateTriangleCost(uint32_t index) const;
+	double calculateTriangleCost(uint32_t v0, uint32_t v1, uint32_t v2) const;
+
+	void validateTriangleNegihbors();
+
+	VertexGenerator m_vertexGenerator;
+
+	double m_scale = 2; // Size of the view being refined
+	double m_tooSmallScale = 0; // Largest view in which triangles were put aside for being too small
+	int m_maxIterations = constants::maxIterations;
+
+	// Vertices and triangles as structures of arrays, the passes over the mesh only touch what they need
+	AlignedVector<glm::vec2> m_positions;
+	AlignedVector<float> m_escapeTimes;
+	AlignedVector<float> m_distances; // Estimated distances to the boundary of the set, infinite if not known
+	std::vector<uint32_t> m_indices;
+
+	std::vector<int> m_nrVertRef; // Number of trianlges a vertex refers to
+	std::vector<uint32_t> m_freeEntries; // array of indices that are free in m_positions
+
+	AlignedVector<double> m_costs;
+	AlignedVector<std::array<int, 3>> m_neighbors;
+	IndexedMaxHeap m_costQueue; // Triangle indices by cost
+	IndexedMaxHeap m_mergeQueue; // Diamond centers by negated merge cost, the cheapest merge on top
+	IndexedMaxHeap m_mergeBySize; // Same diamonds by negated length of the merged hypotenuse, the smallest on top
+
+	DirtyRanges m_dirtyVertices;
+	DirtyRanges m_dirtyIndices;
+	TriangleQuadtree m_quadtree{ geom::BBox2{ {-1,-1}, {1,1} } };
+
+	// Scratch space of generateVertices
+	std::vector<IndexedMaxHeap::Entry> m_taken;
+	std::vector<TriangleSplit> m_splitBatch;
+	AlignedVector<glm::vec2> m_midpointBatch;
+	AlignedVector<float> m_generatedBatch;
+	AlignedVector<float> m_generatedDistances;
+	std::vector<bool> m_claimed;
+	std::vector<uint32_t> m_diamondCandidates;
+};
+
@@ -0,0 +1,187 @@
+#include "pch.h"
+
+#include "TriangleQuadtree.h"
+
+TriangleQuadtree::TriangleQuadtree(const geom::BBox2& bounds, int maxDepth)
+	: m_bounds(bounds), m_maxDepth(maxDepth)
+{
+	clear();
+}
+
+void TriangleQuadtree::clear()
+{
+	m_nodes.clear();
+	m_locations.clear();
+	m_boxes.clear();
+	m_nodes.push_back(Node{ .bounds = m_bounds, .parent = noNode, .depth = 0, .triangles = {} });
+}
+
+void TriangleQuadtree::insert(uint32_t triangle, const geom::BBox2& box)
+{
+	assert(!contains(triangle));
+	if (triangle >= m_locations.size()) {
+		m_locations.resize(triangle + 1);
+		m_boxes.resize(triangle + 1);
+	}
+
+	// Descend as long as a child contains the whole box
+	int node = 0;
+	while (true) {
+		++m_nodes[node].subtreeCount;
+		const int child = childFor(node, box);
+		if (child == noNode) {
+			break;
+		}
+		node = child;
+	}
+
+	auto& triangles = m_nodes[node].triangles;
+	m_locations[triangle] = { node, static_cast<uint32_t>(triangles.size()) };
+	triangles.push_back(triangle);
+	m_boxes[triangle] = box;
+}
+
+void TriangleQuadtree::update(uint32_t triangle, const geom::BBox2& box)
+{
+	if (contains(triangle)) {
+		erase(triangle);
+	}
+	insert(triangle, box);
+}
+
+void TriangleQuadtree::erase(uint32_t triangle)
+{
+	assert(contains(triangle));
+	const Location location = m_locations[triangle];
+	m_locations[triangle].node = noNode;
+
+	// Swap remove from the node
+	auto& triangles = m_nodes[location.node].triangles;
+	const uint32_t last = triangles.back();
+	triangles[location.slot] = last;
+	triangles.pop_back();
+	if (last != triangle) {
+		m_locations[last].slot = location.slot;
+	}
+
+	for (int node = location.node; node != noNode; node = m_nodes[node].parent) {
+		--m_nodes[node].subtreeCount;
+	}
+}
+
+void TriangleQuadtree::rename(uint32_t from, uint32_t to)
+{
+	assert(contains(from) && !contains(to));
+	if (to >= m_locations.size()) {
+		m_locations.resize(to + 1);
+		m_boxes.resize(to + 1);
+	}
+	const Location location = m_locations[from];
+	m_nodes[location.node].triangles[location.slot] = to;
+	m_locations[to] = location;
+	m_locations[from].node = noNode;
+	m_boxes[to] = m_boxes[from];
+}
+
+void TriangleQuadtree::findOutside(const geom::BBox2& box, size_t maxCount, std::vector<uint32_t>& result) const
+{
+	std::vector<int> stack{ 0 };
+	while (!stack.empty() && result.size() < maxCount) {
+		const int index = stack.back();
+		stack.pop_back();
+		const Node& node = m_nodes[index];
+		if (node.subtreeCount == 0 || box.contains(node.bounds)) {
+			continue;
+		}
+		if (!box.collidesWith(node.bounds)) {
+			collectSubtree(index, maxCount, result);
+			continue;
+		}
+		for (uint32_t triangle : node.triangles) {
+			if (result.size() >= maxCount) {
+				return;
+			}
+			if (!box.collidesWith(m_boxes[triangle])) {
+				result.push_back(triangle);
+			}
+		}
+		for (int child : node.children) {
+			if (child != noNode) {
+				stack.push_back(child);
+			}
+		}
+	}
+}
+
+void TriangleQuadtree::findColliding(const geom::BBox2& box, std::vector<uint32_t>& result) const
+{
+	std::vector<int> stack{ 0 };
+	while (!stack.empty()) {
+		const int index = stack.back();
+		stack.pop_back();
+		const Node& node = m_nodes[index];
+		if (node.subtreeCount == 0 || !box.collidesWith(node.bounds)) {
+			continue;
+		}
+		if (box.contains(node.bounds)) {
+			collectSubtree(index, std::numeric_limits<size_t>::max(), result);
+			continue;
+		}
+		for (uint32_t triangle : node.triangles) {
+			if (box.collidesWith(m_boxes[triangle])) {
+				result.push_back(triangle);
+			}
+		}
+		for (int child : node.children) {
+			if (child != noNode) {
+				stack.push_back(child);
+			}
+		}
+	}
+}
+
+int TriangleQuadtree::childFor(int node, const geom::BBox2& box)
+{
+	if (m_nodes[node].depth >= m_maxDepth) {
+		return noNode;
+	}
+	const geom::BBox2 bounds = m_nodes[node].bounds;
+	const glm::vec2 center = bounds.center();
+	const int quadrant = (box.minPoint.x >= center.x ? 1 : 0) + (box.minPoint.y >= center.y ? 2 : 0);
+	const geom::BBox2 childBounds{
+		{ quadrant & 1 ? center.x : bounds.minPoint.x, quadrant & 2 ? center.y : bounds.minPoint.y },
+		{ quadrant & 1 ? bounds.maxPoint.x : center.x, quadrant & 2 ? bounds.maxPoint.y : center.y } };
+	if (!childBounds.contains(box)) {
+		return noNode;
+	}
+
+	if (m_nodes[node].children[quadrant] == noNode) {
+		const int child = static_cast<int>(m_nodes.size());
+		m_nodes.push_back(Node{ .bounds = childBounds, .parent = node, .depth = m_nodes[node].depth + 1, .triangles = {} });
+		m_nodes[node].children[quadrant] = child;
+	}
+	return m_nodes[node].children[quadrant];
+}
+
+void TriangleQuadtree::collectSubtree(int node, size_t maxCount, std::vector<uint32_t>& result) const
+{
+	std::vector<int> stack{ node };
+	while (!stack.empty()) {
+		const Node& current = m_nodes[stack.back()];
+		stack.pop_back();
+		if (current.subtreeCount == 0) {
+			continue;
+		}
+		for (uint32_t triangle : current.triangles) {
+			if (result.size() >= maxCount) {
+				return;
+			}
+			result.push_back(triangle);
+		}
+		for (int child : current.children) {
+			if (child != noNode) {
+				stack.push_back(child);
+			}
+		}
+	}
+}
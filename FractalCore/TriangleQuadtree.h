@@ -0,0 +1,61 @@
+#pragma once
+
+#include "utils.h"
+
+// Spatial index of the triangles of TriangleHandler.
+// Each triangle is stored in the deepest node that fully contains its bounding box. The mesh is
+// built by bisecting a square, so the triangles line up with the nodes and every node only holds
+// a handful of them. Nodes are created on demand and kept around for reuse.
+class TriangleQuadtree
+{
+public:
+	TriangleQuadtree(const geom::BBox2& bounds, int maxDepth = 20);
+
+	void clear();
+
+	void insert(uint32_t triangle, const geom::BBox2& box);
+	// Moves an already inserted triangle, or inserts it
+	void update(uint32_t triangle, const geom::BBox2& box);
+	void erase(uint32_t triangle);
+	// The triangle 'from' is known as 'to' from now on
+	void rename(uint32_t from, uint32_t to);
+
+	bool contains(uint32_t triangle) const {
+		return triangle < m_locations.size() && m_locations[triangle].node != noNode;
+	}
+
+	const geom::BBox2& getBox(uint32_t triangle) const { return m_boxes[triangle]; }
+	size_t size() const { return m_nodes.empty() ? 0 : m_nodes[0].subtreeCount; }
+
+	// Triangles whose bounding box doesn't collide with 'box', at most maxCount of them
+	void findOutside(const geom::BBox2& box, size_t maxCount, std::vector<uint32_t>& result) const;
+	// Triangles whose bounding box collides with 'box'
+	void findColliding(const geom::BBox2& box, std::vector<uint32_t>& result) const;
+
+private:
+	static constexpr int noNode = -1;
+
+	struct Node {
+		geom::BBox2 bounds;
+		int parent;
+		int depth;
+		int children[4] = { noNode, noNode, noNode, noNode };
+		uint32_t subtreeCount = 0;
+		std::vector<uint32_t> triangles;
+	};
+
+	struct Location {
+		int node = noNode;
+		uint32_t slot = 0;
+	};
+
+	int childFor(int node, const geom::BBox2& box);
+	void collectSubtree(int node, size_t maxCount, std::vector<uint32_t>& result) const;
+
+	geom::BBox2 m_bounds;
+	int m_maxDepth;
+
+	std::vector<Node> m_nodes;
+	std::vector<Location> m_locations; // By triangle
+	std::vector<geom::BBox2> m_boxes; // By triangle
+};
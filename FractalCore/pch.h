@@ -0,0 +1,34 @@
+#pragma once
+
+// Only the standard library and glm, the core builds without a window or OpenGL
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <string>
+#include <optional>
+#include <vector>
+#include <complex>
+#include <functional>
+#include <span>
+#include <chrono>
+#include <bit>
+#include <limits>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <memory>
+#include <array>
+#include <compare>
+#include <string_view>
+#include <charconv>
+#include <filesystem>
+#include <deque>
+#include <cstring>
+#include <utility>
+#include <exception>
+
+#include <glm.hpp>
+#include <gtx/compatibility.hpp>
@@ -47,6 +47,11 @@ namespace geom {
 				point.x <= maxPoint.x && point.y <= maxPoint.y;
 		}
 
+		constexpr bool contains(const BBox2& other) const {
+			return other.minPoint.x >= minPoint.x && other.minPoint.y >= minPoint.y &&
+				other.maxPoint.x <= maxPoint.x && other.maxPoint.y <= maxPoint.y;
+		}
+
 		constexpr bool collidesWith(const BBox2& other) const{
 			return !(minPoint.x > other.maxPoint.x || maxPoint.x < other.minPoint.x ||
 					 minPoint.y > other.maxPoint.y || maxPoint.y < other.minPoint.y);
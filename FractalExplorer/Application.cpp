@@ -3,20 +3,33 @@
 #include "Application.h"
 #include "Shader.h"
 #include "utils.h"
-#include "TriangleHandler.h"
-#include "Mandelbrot.h"
+#include "RefinementWorker.h"
+#include "MeshBuffers.h"
+#include "MandelbrotGenerator.h"
+#include "PaletteTexture.h"
+#include "HistogramColoring.h"
+#include "Profiler.h"
+#include "Log.h"
 
 namespace {
 
     Application* App = nullptr;
+
+    constexpr const char* windowTitle = "Fractal Explorer";
+    constexpr double statsInterval = 0.5; // seconds
+    constexpr const char* tracePath = "trace.json";
+
+    std::string bookmarkPath(int number) {
+        return "bookmark" + std::to_string(number) + ".mesh";
+    }
 }
 
 static void GLAPIENTRY glMessageCallback(GLenum source, GLenum type, GLuint id, GLenum severity, GLsizei length, const GLchar* message, const void* userParam) {
 
     if (type == GL_DEBUG_TYPE_ERROR) {
-    std::cout << "[OpenGL message] source: " << source
-        << " type: " << type << " id: " << id << " severity: " << severity << std::endl
-        << "message: " << message << std::endl;
+        FE_LOG_ERROR("[OpenGL message] source: ", source, " type: ", type, " id: ", id, " severity: ", severity,
+            " message: ", message);
+        logging::flush();
         __debugbreak();
     }
 }
@@ -27,7 +40,8 @@ Application::Application()
         throw;
     }
     if (!glfwInit()) {
-        std::cout << "GLFW init failed" << std::endl;
+        FE_LOG_ERROR("GLFW init failed");
+        logging::flush();
         throw;
     }
 }
@@ -57,65 +71,41 @@ void Application::run()
     glGenVertexArrays(1, &vertexArrayId);
     glBindVertexArray(vertexArrayId);
 
-
-
-    uint32_t indexBufferId;
-    glGenBuffers(1, &indexBufferId);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBufferId);
-
-
-    uint32_t vertexBufferId;
-    glGenBuffers(1, &vertexBufferId);
-    glBindBuffer(GL_ARRAY_BUFFER, vertexBufferId);
-
+    MeshBuffers meshBuffers{ constants::maxVertices, constants::maxIndices };
 
     glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), 0);
     glEnableVertexAttribArray(0);
-    glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, sizeof(Vertex), (const void*)offsetof(Vertex, color));
+    glVertexAttribPointer(1, 1, GL_FLOAT, GL_FALSE, sizeof(Vertex), (const void*)offsetof(Vertex, escapeTime));
     glEnableVertexAttribArray(1);
 
     // Uniform stuff
     auto locationUniformId = glGetUniformLocation(program->getId(), "camera");
     auto zoomUniformId = glGetUniformLocation(program->getId(), "zoom");
 
-    constexpr auto getColor = [](double value)->Color {
-        constexpr int divider = 500;
-        const int floor = static_cast<int>(value);
-        double v = (floor % divider) + value - floor;
-        Color colors[] = {
-            Color{0,0,0,1},
-            Color{0,0,1,1},
-            Color{0,1,1,1},
-            Color{1,0,0,1},
-            Color{1,1,0,1},
-            Color{1,1,1,1},
-        };
-        const auto size = std::size(colors);
-        const double slice = static_cast<double>(divider) / size;
-        for (int i = 0; i < size; ++i) {
-            double start = i * slice;
-            if (v <= start) {
-                Color c1 = colors[i];
-                Color c2 = i < size - 1 ? colors[i + 1] : colors[0];
-                float f = (start - v) / slice;
-                return glm::lerp(c2, c1, {f,f,f,f});
-            }
-        }
-        return { 0,0,0,0 };
-    };
+    auto paletteRangeUniformId = glGetUniformLocation(program->getId(), "paletteRange");
+
+    // Coloring happens on the GPU, the palette is sampled by escape time
+    PaletteTexture palette;
+    palette.bind(0);
+    glUniform1i(glGetUniformLocation(program->getId(), "palette"), 0);
+    HistogramColoring histogramColoring{ constants::maxIterations };
+    bool histogramColoringShown = false;
 
+    // The generator estimates distances or not from the start, so toggling it starts the worker over.
+    // The samples stay in the cache for the next worker.
+    const auto sampleCache = std::make_shared<SampleCache>();
+    bool estimatingDistance = m_distanceEstimation;
+    std::optional<RefinementWorker> refinementWorker;
+    refinementWorker.emplace(MandelbrotVertexGenerator{ sampleCache, estimatingDistance });
 
-    TriangleHandler triangleHandler{ [](glm::vec2 pos, double scale, int maxIter ) {
-        auto a = mandelbrot::calculateSmoothEscapeTime(std::complex<float>(pos.x, pos.y), maxIter);
-        //float c = a / (double)maxIter;
-        return Vertex{ pos, getColor(a)};
-    } };
+    MeshUpdate meshUpdate;
 
     glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
 
     /* Loop until the user closes the window */
     while (!glfwWindowShouldClose(m_window))
     {
+        profiler::ScopedTimer frameTimer{ "frame" };
 
         // Update mouse position
         glm::vec2 oldMousePos = m_mouseInfo.position;
@@ -128,8 +118,19 @@ void Application::run()
             auto delta = (m_mouseInfo.position - oldMousePos);
             delta.x *= -1; 
             m_navigationInfo.realPosition += (delta * 0.001f / m_navigationInfo.realZoom);
-            std::cout << "pos: " << m_navigationInfo.realPosition.x << " " << m_navigationInfo.realPosition.y << std::endl;
-            std::cout << "worldPos: " << mouseWorldPos().x << " " << mouseWorldPos().y << std::endl;
+            FE_LOG_TRACE("pos: ", m_navigationInfo.realPosition.x, " ", m_navigationInfo.realPosition.y);
+            FE_LOG_TRACE("worldPos: ", mouseWorldPos().x, " ", mouseWorldPos().y);
+        }
+
+        // The key callback only notes the bookmark, the worker is known here
+        if (m_bookmarkToSave != 0) {
+            refinementWorker->saveSnapshot(bookmarkPath(m_bookmarkToSave));
+            FE_LOG_INFO("Saving bookmark to ", bookmarkPath(m_bookmarkToSave));
+            m_bookmarkToSave = 0;
+        }
+        if (m_bookmarkToLoad != 0) {
+            loadBookmark(*refinementWorker, m_bookmarkToLoad);
+            m_bookmarkToLoad = 0;
         }
 
         // Interpolate real position and camera position
@@ -143,20 +144,42 @@ void Application::run()
         auto screenSize = glm::vec2{1,1} * (1.0f / m_navigationInfo.cameraZoom);
         geom::BBox2 screenBb{ m_navigationInfo.cameraPosition - (screenSize), m_navigationInfo.cameraPosition + (screenSize) };
 
-        triangleHandler.removeTrianglesOutsideScreen(screenBb, 2000);
-        triangleHandler.generateVertices(screenBb, 400);
-        const auto& indices = triangleHandler.getIndeices();
-        const auto& vertices = triangleHandler.getVertices();
+        if (m_distanceEstimation != estimatingDistance) {
+            estimatingDistance = m_distanceEstimation;
+            refinementWorker.emplace(MandelbrotVertexGenerator{ sampleCache, estimatingDistance });
+            FE_LOG_INFO("Distance estimation ", estimatingDistance ? "on" : "off");
+        }
+
+        // Refinement happens on the worker thread, only the parts it changed are uploaded
+        refinementWorker->setView(screenBb);
+        refinementWorker->setCollectHistogram(m_histogramColoring);
+        if (refinementWorker->takeUpdate(meshUpdate)) {
+            meshBuffers.apply(meshUpdate);
+
+            // Only the palette changes with the histogram, the mesh stays as it is
+            if (m_histogramColoring && !meshUpdate.histogram.empty()) {
+                histogramColoring.update(meshUpdate.histogram);
+                palette.update([&](double escapeTime) { return histogramColoring.getColor(escapeTime); }, histogramColoring.getRange(), false);
+                histogramColoringShown = true;
+            }
+        }
+        if (!m_histogramColoring && histogramColoringShown) {
+            palette.update(coloring::getColor, coloring::paletteCycle, true);
+            histogramColoringShown = false;
+        }
 
         glUniform4f(locationUniformId, m_navigationInfo.cameraPosition.x, m_navigationInfo.cameraPosition.y, 0.0f, 1.0f);
         glUniform1f(zoomUniformId, m_navigationInfo.cameraZoom);
-        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(int), indices.data(), GL_DYNAMIC_DRAW);
-        glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), vertices.data(), GL_DYNAMIC_DRAW);
+        glUniform1f(paletteRangeUniformId, static_cast<float>(palette.getRange()));
 
-        glDrawElements(GL_TRIANGLES, indices.size(), GL_UNSIGNED_INT, nullptr);
+        meshBuffers.draw();
 
         /* Swap front and back buffers */
-        glfwSwapBuffers(m_window);
+        {
+            profiler::ScopedTimer timer{ "swap" };
+            glfwSwapBuffers(m_window);
+        }
+        updateStatsLine();
 
         /* Poll for and process events */
         glfwPollEvents();
@@ -191,6 +214,88 @@ void Application::toggleWireframe()
     glPolygonMode(GL_FRONT_AND_BACK, wireframe ? GL_LINE : GL_FILL);
 }
 
+void Application::toggleHistogramColoring()
+{
+    m_histogramColoring = !m_histogramColoring;
+}
+
+void Application::toggleDistanceEstimation()
+{
+    m_distanceEstimation = !m_distanceEstimation;
+}
+
+void Application::updateStatsLine()
+{
+    const auto now = std::chrono::steady_clock::now();
+    const double elapsed = std::chrono::duration<double>(now - m_statsInfo.lastUpdate).count();
+    if (elapsed < statsInterval) {
+        return;
+    }
+    m_statsInfo.lastUpdate = now;
+
+    const auto totals = profiler::takeTotals();
+    const auto find = [&](std::string_view name) {
+        const auto total = std::ranges::find_if(totals, [&](const auto& t) { return name == t.name; });
+        return total != totals.end() ? *total : profiler::ScopeTotal{ nullptr, 0, 0 };
+    };
+    const auto perFrame = [&](std::string_view name) {
+        const int frames = std::max(find("frame").calls, 1);
+        return find(name).seconds * 1000 / frames;
+    };
+    const double refining = find("removeTrianglesOutsideScreen").seconds + find("mergeTriangles").seconds + find("generateVertices").seconds;
+
+    const uint64_t samples = profiler::get(profiler::Counter::Samples);
+    const uint64_t iterations = profiler::get(profiler::Counter::Iterations);
+    const uint64_t cacheHits = profiler::get(profiler::Counter::CacheHits);
+    const uint64_t newSamples = samples - m_statsInfo.samples;
+    const uint64_t newHits = cacheHits - m_statsInfo.cacheHits;
+
+    std::ostringstream title;
+    title.precision(2);
+    title << std::fixed << windowTitle
+        << " | frame " << perFrame("frame") << " ms"
+        << " | upload " << perFrame("upload") << " ms"
+        << " | swap " << perFrame("swap") << " ms"
+        << " | refining " << 100 * refining / elapsed << "%"
+        << " | " << newSamples / elapsed / 1e3 << " k samples/s"
+        << " (" << (newSamples ? 100.0 * newHits / newSamples : 0.0) << "% cached)"
+        << " | " << (iterations - m_statsInfo.iterations) / elapsed / 1e6 << " M iterations/s";
+    glfwSetWindowTitle(m_window, title.str().c_str());
+
+    m_statsInfo.samples = samples;
+    m_statsInfo.iterations = iterations;
+    m_statsInfo.cacheHits = cacheHits;
+}
+
+void Application::writeTrace()
+{
+    if (profiler::writeChromeTrace(tracePath)) {
+        FE_LOG_INFO("Trace written to ", tracePath);
+    }
+    else {
+        FE_LOG_ERROR("Failed to write ", tracePath);
+    }
+}
+
+void Application::loadBookmark(RefinementWorker& refinementWorker, int number)
+{
+    const std::string path = bookmarkPath(number);
+    auto snapshot = MeshSnapshot::open(path);
+    if (!snapshot) {
+        FE_LOG_WARNING("No bookmark in ", path);
+        return;
+    }
+
+    // The camera jumps there instead of sliding, the mesh is already refined for that view
+    const geom::BBox2& view = snapshot->getView();
+    m_navigationInfo.realPosition = (view.minPoint + view.maxPoint) * 0.5f;
+    m_navigationInfo.realZoom = 2 / (view.maxPoint.x - view.minPoint.x);
+    m_navigationInfo.cameraPosition = m_navigationInfo.realPosition;
+    m_navigationInfo.cameraZoom = m_navigationInfo.realZoom;
+    refinementWorker.loadSnapshot(std::move(*snapshot));
+    FE_LOG_INFO("Bookmark loaded from ", path);
+}
+
 glm::vec2 Application::mouseWorldPos() const
 {
     int w, h;
@@ -209,9 +314,9 @@ void Application::initialize()
     glfwWindowHint(GLFW_OPENGL_DEBUG_CONTEXT, GL_TRUE);
 
     /* Create a windowed mode window and its OpenGL context */
-    m_window = glfwCreateWindow(1280, 1280, "Fractal Explorer", NULL, NULL);
+    m_window = glfwCreateWindow(1280, 1280, windowTitle, NULL, NULL);
     if (!m_window) {
-        std::cout << "GLFW failed to create window" << std::endl;
+        FE_LOG_ERROR("GLFW failed to create window");
         return;
     }
 
@@ -228,11 +333,11 @@ void Application::initialize()
 
     /*Init glew*/
     if (glewInit() != GLEW_OK) {
-        std::cout << "GLEW init failed" << std::endl;
+        FE_LOG_ERROR("GLEW init failed");
         return;
     }
 
-    std::cout << glGetString(GL_VERSION) << std::endl;
+    FE_LOG_INFO("OpenGL ", glGetString(GL_VERSION));
 
     glEnable(GL_DEBUG_OUTPUT);
     glDebugMessageCallback(glMessageCallback, nullptr);
@@ -241,15 +346,28 @@ void Application::initialize()
 
 void Application::keyCallback(GLFWwindow* window, int key, int scancode, int action, int mods)
 {
-    std::cout << "Key event: " << key
-        << " scancode: " << scancode << " action: " << action << " mods: " << mods << std::endl;
+    FE_LOG_TRACE("Key event: ", key, " scancode: ", scancode, " action: ", action, " mods: ", mods);
 
     if (action) {
         switch (key)
         {
             case GLFW_KEY_F6:
                 App->toggleWireframe();
+                break;
+            case GLFW_KEY_F7:
+                App->toggleHistogramColoring();
+                break;
+            case GLFW_KEY_F8:
+                App->writeTrace();
+                break;
+            case GLFW_KEY_F9:
+                App->toggleDistanceEstimation();
+                break;
             default:
+                // Ctrl and a number saves a bookmark, the number alone goes back to it
+                if (action == GLFW_PRESS && key >= GLFW_KEY_1 && key <= GLFW_KEY_9) {
+                    (mods & GLFW_MOD_CONTROL ? App->m_bookmarkToSave : App->m_bookmarkToLoad) = key - GLFW_KEY_0;
+                }
                 break;
         }
     }
@@ -257,8 +375,7 @@ void Application::keyCallback(GLFWwindow* window, int key, int scancode, int act
 
 void Application::mouseButtonCallback(GLFWwindow* window, int button, int action, int mods)
 {
-    std::cout << "Mouse event: " << button
-         << " action: " << action << " mods: " << mods << std::endl;
+    FE_LOG_TRACE("Mouse event: ", button, " action: ", action, " mods: ", mods);
 
     if (button == GLFW_MOUSE_BUTTON_LEFT) {
         if (action == 0) {
@@ -1,5 +1,6 @@
 #pragma once
 
+class RefinementWorker;
 
 namespace mouse {
 	constexpr int mouseLeft = 0x1;
@@ -26,10 +27,23 @@ private:
 
 	void zoom(float multiplier);
 	void toggleWireframe();
+	void toggleHistogramColoring();
+	// Refines towards the boundary with distance estimates, see MandelbrotVertexGenerator
+	void toggleDistanceEstimation();
+
+	// Timings and counters of the profiler in the window title, refreshed a couple of times a second
+	void updateStatsLine();
+	void writeTrace();
+	// Bookmarks are mesh snapshots with the view they were saved in
+	void loadBookmark(RefinementWorker& refinementWorker, int number);
 
 	glm::vec2 mouseWorldPos() const;
 
 	GLFWwindow* m_window = nullptr;
+	bool m_histogramColoring = false;
+	bool m_distanceEstimation = false;
+	int m_bookmarkToSave = 0; // Number of the bookmark, 0 if none
+	int m_bookmarkToLoad = 0;
 
 	struct NavigationInfo {
 		glm::vec2 cameraPosition = {0,0};
@@ -44,6 +58,13 @@ private:
 		int buttons;
 	} m_mouseInfo;
 
+	struct StatsInfo {
+		std::chrono::steady_clock::time_point lastUpdate = std::chrono::steady_clock::now();
+		uint64_t samples = 0;
+		uint64_t iterations = 0;
+		uint64_t cacheHits = 0;
+	} m_statsInfo;
+
 
 
 };
@@ -1,9 +1,16 @@
 #include "pch.h"
 
 #include "Application.h"
+#include "RenderCli.h"
 
 // Entry point
-void main() {
+int main(int argc, char** argv) {
+    // Any arguments mean a headless render
+    if (argc > 1) {
+        return runRenderCli(argc, argv);
+    }
+
     Application app;
     app.run();
-}
\ No newline at end of file
+    return 0;
+}
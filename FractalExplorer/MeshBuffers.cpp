@@ -0,0 +1,131 @@
+#include "pch.h"
+
+#include "MeshBuffers.h"
+#include "Profiler.h"
+
+namespace {
+	constexpr GLbitfield mapFlags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+
+	// How long a single wait for a fence can take
+	constexpr GLuint64 fenceTimeoutNs = 1'000'000;
+}
+
+MeshBuffers::MeshBuffers(size_t maxVertices, size_t maxIndices)
+	: m_maxVertices(maxVertices), m_maxIndices(maxIndices)
+{
+	const GLsizeiptr vertexBytes = segmentCount * maxVertices * sizeof(Vertex);
+	const GLsizeiptr indexBytes = segmentCount * maxIndices * sizeof(uint32_t);
+
+	glGenBuffers(1, &m_indexBufferId);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_indexBufferId);
+	glBufferStorage(GL_ELEMENT_ARRAY_BUFFER, indexBytes, nullptr, mapFlags);
+	m_mappedIndices = static_cast<uint32_t*>(glMapBufferRange(GL_ELEMENT_ARRAY_BUFFER, 0, indexBytes, mapFlags));
+
+	glGenBuffers(1, &m_vertexBufferId);
+	glBindBuffer(GL_ARRAY_BUFFER, m_vertexBufferId);
+	glBufferStorage(GL_ARRAY_BUFFER, vertexBytes, nullptr, mapFlags);
+	m_mappedVertices = static_cast<Vertex*>(glMapBufferRange(GL_ARRAY_BUFFER, 0, vertexBytes, mapFlags));
+
+	assert(m_mappedIndices && m_mappedVertices);
+}
+
+MeshBuffers::~MeshBuffers()
+{
+	for (auto& segment : m_segments) {
+		if (segment.fence) {
+			glDeleteSync(segment.fence);
+		}
+	}
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_indexBufferId);
+	glUnmapBuffer(GL_ELEMENT_ARRAY_BUFFER);
+	glBindBuffer(GL_ARRAY_BUFFER, m_vertexBufferId);
+	glUnmapBuffer(GL_ARRAY_BUFFER);
+	glDeleteBuffers(1, &m_indexBufferId);
+	glDeleteBuffers(1, &m_vertexBufferId);
+}
+
+void MeshBuffers::apply(const MeshUpdate& update)
+{
+	assert(update.vertexCount <= m_maxVertices && update.indexCount <= m_maxIndices);
+	m_vertices.resize(update.vertexCount);
+	m_indices.resize(update.indexCount);
+
+	auto vertex = update.vertices.begin();
+	for (const auto& range : update.vertexRanges) {
+		std::copy_n(vertex, range.end - range.begin, m_vertices.begin() + range.begin);
+		vertex += range.end - range.begin;
+	}
+	auto index = update.indices.begin();
+	for (const auto& range : update.indexRanges) {
+		std::copy_n(index, range.end - range.begin, m_indices.begin() + range.begin);
+		index += range.end - range.begin;
+	}
+
+	for (auto& segment : m_segments) {
+		for (const auto& range : update.vertexRanges) {
+			segment.vertices.add(range.begin, range.end);
+		}
+		for (const auto& range : update.indexRanges) {
+			segment.indices.add(range.begin, range.end);
+		}
+	}
+}
+
+void MeshBuffers::draw()
+{
+	// Keep drawing from the same copy as long as it is up to date
+	const Segment& current = m_segments[m_current];
+	if (!current.vertices.empty() || !current.indices.empty() ||
+		current.vertexCount != m_vertices.size() || current.indexCount != m_indices.size()) {
+		m_current = (m_current + 1) % segmentCount;
+		write(m_current);
+	}
+
+	Segment& segment = m_segments[m_current];
+	const size_t indexOffset = m_current * m_maxIndices * sizeof(uint32_t);
+	glDrawElementsBaseVertex(GL_TRIANGLES, static_cast<GLsizei>(segment.indexCount), GL_UNSIGNED_INT,
+		reinterpret_cast<void*>(indexOffset), static_cast<GLint>(m_current * m_maxVertices));
+
+	if (segment.fence) {
+		glDeleteSync(segment.fence);
+	}
+	segment.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+void MeshBuffers::write(int index)
+{
+	profiler::ScopedTimer timer{ "upload" };
+	Segment& segment = m_segments[index];
+	waitFor(segment);
+
+	segment.vertices.clip(m_vertices.size());
+	Vertex* vertices = m_mappedVertices + index * m_maxVertices;
+	for (const auto& range : segment.vertices.getRanges()) {
+		std::copy(m_vertices.begin() + range.begin, m_vertices.begin() + range.end, vertices + range.begin);
+	}
+	segment.indices.clip(m_indices.size());
+	uint32_t* indices = m_mappedIndices + index * m_maxIndices;
+	for (const auto& range : segment.indices.getRanges()) {
+		std::copy(m_indices.begin() + range.begin, m_indices.begin() + range.end, indices + range.begin);
+	}
+
+	segment.vertices.clear();
+	segment.indices.clear();
+	segment.vertexCount = m_vertices.size();
+	segment.indexCount = m_indices.size();
+}
+
+void MeshBuffers::waitFor(Segment& segment)
+{
+	if (!segment.fence) {
+		return;
+	}
+	while (true) {
+		const GLenum result = glClientWaitSync(segment.fence, GL_SYNC_FLUSH_COMMANDS_BIT, fenceTimeoutNs);
+		if (result != GL_TIMEOUT_EXPIRED) {
+			break;
+		}
+	}
+	glDeleteSync(segment.fence);
+	segment.fence = nullptr;
+}
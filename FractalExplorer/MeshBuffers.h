@@ -0,0 +1,49 @@
+#pragma once
+
+#include "RefinementWorker.h"
+
+// The mesh in persistently mapped GPU buffers. Each buffer holds three copies of the mesh and the
+// copy being written is always one the GPU has finished drawing from, which fences make sure of.
+// Only the ranges that changed since a copy was last written are written to it.
+class MeshBuffers
+{
+public:
+	// Creates the buffers and binds them to the current vertex array
+	MeshBuffers(size_t maxVertices, size_t maxIndices);
+	~MeshBuffers();
+
+	MeshBuffers(const MeshBuffers&) = delete;
+	MeshBuffers& operator=(const MeshBuffers&) = delete;
+
+	void apply(const MeshUpdate& update);
+	void draw();
+
+private:
+	static constexpr int segmentCount = 3;
+
+	struct Segment {
+		DirtyRanges vertices;
+		DirtyRanges indices;
+		size_t vertexCount = 0;
+		size_t indexCount = 0;
+		GLsync fence = nullptr;
+	};
+
+	void write(int segment);
+	void waitFor(Segment& segment);
+
+	size_t m_maxVertices;
+	size_t m_maxIndices;
+
+	uint32_t m_vertexBufferId = 0;
+	uint32_t m_indexBufferId = 0;
+	Vertex* m_mappedVertices = nullptr;
+	uint32_t* m_mappedIndices = nullptr;
+
+	// Latest mesh, the segments are written from these
+	std::vector<Vertex> m_vertices;
+	std::vector<uint32_t> m_indices;
+
+	Segment m_segments[segmentCount];
+	int m_current = 0;
+};
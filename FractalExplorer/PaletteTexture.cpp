@@ -0,0 +1,39 @@
+#include "pch.h"
+
+#include "PaletteTexture.h"
+
+PaletteTexture::PaletteTexture(int size)
+	: m_size(size)
+{
+	glGenTextures(1, &m_textureId);
+	glBindTexture(GL_TEXTURE_1D, m_textureId);
+	glTexParameteri(GL_TEXTURE_1D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_1D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+	update(coloring::getColor, coloring::paletteCycle, true);
+}
+
+PaletteTexture::~PaletteTexture()
+{
+	glDeleteTextures(1, &m_textureId);
+}
+
+void PaletteTexture::update(const std::function<Color(double)>& palette, double range, bool repeat)
+{
+	// Texel centers, the texture is sampled with linear filtering in between
+	std::vector<Color> texels(m_size);
+	for (int i = 0; i < m_size; ++i) {
+		texels[i] = palette((i + 0.5) * range / m_size);
+	}
+	m_range = range;
+
+	glBindTexture(GL_TEXTURE_1D, m_textureId);
+	glTexParameteri(GL_TEXTURE_1D, GL_TEXTURE_WRAP_S, repeat ? GL_REPEAT : GL_CLAMP_TO_EDGE);
+	glTexImage1D(GL_TEXTURE_1D, 0, GL_RGBA32F, m_size, 0, GL_RGBA, GL_FLOAT, texels.data());
+}
+
+void PaletteTexture::bind(uint32_t unit) const
+{
+	glActiveTexture(GL_TEXTURE0 + unit);
+	glBindTexture(GL_TEXTURE_1D, m_textureId);
+}
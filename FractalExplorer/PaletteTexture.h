@@ -0,0 +1,27 @@
+#pragma once
+
+#include "Coloring.h"
+
+// The palette as a 1D texture over escape times [0, getRange()), by default the repeating palette of coloring::getColor.
+// Vertices only carry their escape time, the fragment shader looks the color up from here.
+class PaletteTexture
+{
+public:
+	explicit PaletteTexture(int size = 1024);
+	~PaletteTexture();
+
+	PaletteTexture(const PaletteTexture&) = delete;
+	PaletteTexture& operator=(const PaletteTexture&) = delete;
+
+	// Fills the texture from a function of the smooth escape time over [0, range). With 'repeat' the same
+	// colors repeat for longer escape times, otherwise they get the color at the end. The mesh doesn't need recomputing.
+	void update(const std::function<Color(double)>& palette, double range, bool repeat);
+	void bind(uint32_t unit) const;
+
+	double getRange() const { return m_range; }
+
+private:
+	uint32_t m_textureId = 0;
+	int m_size;
+	double m_range = 0;
+};
@@ -1,6 +1,7 @@
 #include "pch.h"
 
 #include "Shader.h"
+#include "Log.h"
 
 constexpr unsigned int shaderTypeToGlType(ShaderType type) {
 	switch (type)
@@ -37,7 +38,7 @@ std::optional<Shader> Shader::compileShader(std::string source, ShaderType type)
 		std::vector<char> msg;
 		msg.resize(lenght);
 		glGetShaderInfoLog(id, lenght, &lenght, msg.data());
-		std::cout << "Failed to compile shader: " << msg.data() << std::endl;
+		FE_LOG_ERROR("Failed to compile shader: ", msg.data());
 		return std::nullopt;
 	}
 	Shader shader;
@@ -71,7 +72,7 @@ std::optional<ShaderProgram> ShaderProgram::createAndLink(const std::vector<Shad
 		std::vector<char> msg;
 		msg.resize(lenght);
 		glGetProgramInfoLog(id, lenght, &lenght, msg.data());
-		std::cout << "Program validation failed: " << msg.data() << std::endl;
+		FE_LOG_ERROR("Program validation failed: ", msg.data());
 		return std::nullopt;
 	}
 	ShaderProgram program;
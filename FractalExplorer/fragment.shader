@@ -2,8 +2,11 @@
 
 layout(location = 0) out vec4 color;
 
-in vec4 outColor;
+in float outEscapeTime;
+
+uniform sampler1D palette; // Covers escape times [0, paletteRange)
+uniform float paletteRange;
 
 void main() {
-	color = outColor;
+	color = texture(palette, outEscapeTime / paletteRange);
 };
\ No newline at end of file
@@ -3,17 +3,6 @@
 #include "GL/glew.h"
 #include <GLFW/glfw3.h>
 
+#include "../FractalCore/pch.h"
 
-#include <iostream>
-#include <fstream>
-#include <algorithm>
-#include <string>
-#include <optional>
-#include <vector>
-#include <complex>
-#include <functional>
-
-#include <glm.hpp>
-#include <gtx/compatibility.hpp>
-
-#include "glUtils.h"
\ No newline at end of file
+#include "glUtils.h"
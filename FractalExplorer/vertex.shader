@@ -1,9 +1,9 @@
 #version 460 core
 
 layout(location = 0) in vec4 position;
-layout(location = 1) in vec4 color;
+layout(location = 1) in float escapeTime;
 
-out vec4 outColor; // output a color to the fragment shader
+out float outEscapeTime; // output the escape time to the fragment shader, colored there
 
 uniform vec4 camera;
 uniform float zoom;
@@ -11,5 +11,5 @@ uniform float zoom;
 void main() {
 	gl_Position = (position - camera)*zoom;
 	gl_Position.w = 1;
-	outColor = color;
+	outEscapeTime = escapeTime;
 };
@@ -0,0 +1,8 @@
+#include "pch.h"
+
+#include "RenderCli.h"
+
+// Entry point of the headless renderer, for machines without a window or a gpu
+int main(int argc, char** argv) {
+	return runRenderCli(argc, argv);
+}